@@ -1,10 +1,17 @@
 #define WIN32_LEAN_AND_MEAN
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <random>
 #include <string>
+#include <thread>
 #include <Windows.h>
+#include <Psapi.h>
 
 #include "ZDriveCompiler.hpp"
 #include "ZDriveVM.hpp"
@@ -12,10 +19,23 @@
 using TGLib::i32;
 using TGLib::i64;
 using TGLib::u32;
+using TGLib::u64;
 using TGLib::usize;
 
-static void compileToFile(std::vector<std::string> inPaths, std::string outPath, std::string entryName);
+static void compileToFile(std::vector<std::string> inPaths, std::string outPath, std::string entryName, std::string cacheDir = "");
+static void verifyCache(std::string cacheDir, bool removeBad);
+static void compileObjectFile(std::string inPath, std::string outPath);
+static void linkToFile(std::vector<std::string> inPaths, std::string outPath, std::string entryName);
 static void runFile(std::string path);
+static void transpileFile(std::string inPath, std::string outPath, std::string tableName);
+static void mineFiles(std::vector<std::string> paths, u32 length);
+static void benchCompile(std::vector<std::string> inPaths, u32 repetitions);
+static void benchMath(u32 count);
+static void benchLockstep(std::string path, bool deterministic);
+static void benchBudget(std::string path, double budgetMs);
+static void benchPost(std::string path, u32 posters);
+static void benchSnapshot(std::string path);
+static void testWaitChange();
 
 int main(int argc, const char* argv[]) {
 	std::vector<std::string> args(argv, argv + argc);
@@ -27,12 +47,52 @@ int main(int argc, const char* argv[]) {
 	} else if (argc >= 5 && !args[1].compare("compileAndRun")) {
 		compileToFile(std::vector<std::string>(&argv[3], &argv[argc - 1]), args[argc - 1], args[2]);
 		runFile(args[argc - 1]);
+	} else if (argc >= 6 && !args[1].compare("compileCached")) {
+		compileToFile(std::vector<std::string>(&argv[4], &argv[argc - 1]), args[argc - 1], args[3], args[2]);
+	} else if ((argc == 3 || argc == 4) && !args[1].compare("verifyCache")) {
+		verifyCache(args[2], argc == 4 && !args[3].compare("remove"));
+	} else if (argc == 4 && !args[1].compare("compileObject")) {
+		compileObjectFile(args[2], args[3]);
+	} else if (argc >= 5 && !args[1].compare("link")) {
+		linkToFile(std::vector<std::string>(&argv[3], &argv[argc - 1]), args[argc - 1], args[2]);
 	} else if (argc == 3 && !args[1].compare("run")) {
 		runFile(args[2]);
+	} else if ((argc == 4 || argc == 5) && !args[1].compare("transpile")) {
+		transpileFile(args[2], args[3], argc == 5 ? args[4] : "zdriveNativeSubs");
+	} else if (argc >= 4 && !args[1].compare("mine")) {
+		mineFiles(std::vector<std::string>(&argv[3], &argv[argc]), strtoul(argv[2], nullptr, 10));
+	} else if (argc >= 4 && !args[1].compare("benchCompile")) {
+		benchCompile(std::vector<std::string>(&argv[3], &argv[argc]), strtoul(argv[2], nullptr, 10));
+	} else if (argc == 3 && !args[1].compare("benchMath")) {
+		benchMath(strtoul(argv[2], nullptr, 10));
+	} else if ((argc == 3 || argc == 4) && !args[1].compare("benchLockstep")) {
+		benchLockstep(args[2], argc == 4 && !args[3].compare("det"));
+	} else if (argc == 4 && !args[1].compare("benchBudget")) {
+		benchBudget(args[2], strtod(argv[3], nullptr));
+	} else if (argc == 4 && !args[1].compare("benchPost")) {
+		benchPost(args[2], strtoul(argv[3], nullptr, 10));
+	} else if (argc == 3 && !args[1].compare("benchSnapshot")) {
+		benchSnapshot(args[2]);
+	} else if (argc == 2 && !args[1].compare("testWaitChange")) {
+		testWaitChange();
 	} else {
 		std::cerr << "Usage: run <inputPath>" << std::endl;
-		std::cerr << "Usage: compile <entry func name> <input path 1> [...] [input path n] <output path>" << std::endl;
-		std::cerr << "Usage: compileAndRun <entry func name> <input path 1> [...] [input path n] <output path>" << std::endl;
+		std::cerr << "Usage: compile <entry func name> [--shared <path>] <input path 1> [...] [input path n] <output path>" << std::endl;
+		std::cerr << "Usage: compileAndRun <entry func name> [--shared <path>] <input path 1> [...] [input path n] <output path>" << std::endl;
+		std::cerr << "Usage: compileCached <cache dir> <entry func name> [--shared <path>] <input path 1> [...] [input path n] <output path>" << std::endl;
+		std::cerr << "       (each input is its own module, so its binds are its own. --shared files go in front of every input, for binds they all use.)" << std::endl;
+		std::cerr << "Usage: verifyCache <cache dir> [remove]" << std::endl;
+		std::cerr << "Usage: compileObject <input path> <output path>" << std::endl;
+		std::cerr << "Usage: link <entry func name> <object path 1> [...] [object path n] <output path>" << std::endl;
+		std::cerr << "Usage: transpile <compiled input path> <output .cpp path> [table name]" << std::endl;
+		std::cerr << "Usage: mine <sequence length> <compiled input path 1> [...] [compiled input path n]" << std::endl;
+		std::cerr << "Usage: benchCompile <repetitions> <input path 1> [...] [input path n]" << std::endl;
+		std::cerr << "Usage: benchMath <count>" << std::endl;
+		std::cerr << "Usage: benchLockstep <compiled input path> [det]" << std::endl;
+		std::cerr << "Usage: benchBudget <compiled input path> <frame time budget in ms>" << std::endl;
+		std::cerr << "Usage: benchPost <compiled input path> <posting threads>" << std::endl;
+		std::cerr << "Usage: benchSnapshot <compiled input path>" << std::endl;
+		std::cerr << "Usage: testWaitChange" << std::endl;
 		exit(64);
 	}
 
@@ -60,16 +120,14 @@ static std::vector<i32> readFileToInts(std::string spath) {
 	return buf;
 }
 
-static void compileToFile(std::vector<std::string> inPaths, std::string outPath, std::string entryName) {
-	std::string source;
-	for (std::string file : inPaths) {
-		source.append(readFileToString(file));
-	}
-
-	ZDrive::Compiler::LangDecl lang;
-	lang.DeclareDefaultBaseIns();
+static void writeIntsToFile(std::vector<i32> const& ints, std::string outPath) {
+	std::fstream outputFile = std::fstream(outPath, std::ios::out | std::ios::binary);
+	outputFile.write((const char*)(ints.data()), ints.size() * sizeof(i32));
+	outputFile.close();
+}
 
-	std::vector<i32> result = ZDrive::Compiler::Compile(lang, source, entryName);
+static void linkAndWrite(std::vector<ZDrive::Compiler::ObjectModule> const& modules, std::string outPath, std::string entryName) {
+	std::vector<i32> result = ZDrive::Compiler::Link(modules, entryName);
 
 	if (result.size() == 0) { 
 		ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << "result.size() = 0. Compilation failed.";
@@ -78,9 +136,80 @@ static void compileToFile(std::vector<std::string> inPaths, std::string outPath,
 		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << "Compiled sucessfully.";
 	}
 
-	std::fstream outputFile = std::fstream(outPath, std::ios::out | std::ios::binary);
-	outputFile.write((const char*)(result.data()), result.size() * sizeof(i32));
-	outputFile.close();
+	writeIntsToFile(result, outPath);
+}
+
+static void compileToFile(std::vector<std::string> inPaths, std::string outPath, std::string entryName, std::string cacheDir) {
+	ZDrive::Compiler::LangDecl lang;
+	lang.DeclareDefaultBaseIns();
+
+	// every file is its own module, so they compile in parallel and the cache can skip the ones that didn't change.
+	// files given with --shared go in front of every module instead, for binds the others use. They're part of each
+	// module's source, so the cache sees when they change, but lines in errors count from the start of them.
+	std::string shared;
+	std::vector<ZDrive::Compiler::ModuleSource> sources;
+	for (usize i = 0; i < inPaths.size(); i++) {
+		if (!inPaths[i].compare("--shared") && i + 1 < inPaths.size()) {
+			shared.append(readFileToString(inPaths[++i])).push_back('\n');
+			continue;
+		}
+		sources.push_back({ inPaths[i], readFileToString(inPaths[i]) });
+	}
+	for (auto& source : sources) source.source.insert(0, shared);
+
+	std::optional<ZDrive::Compiler::CompileCache> cache;
+	if (!cacheDir.empty()) cache.emplace(cacheDir);
+
+	auto compiled = ZDrive::Compiler::CompileModules(lang, sources, {}, 0, cache ? &cache.value() : nullptr);
+	if (cache) {
+		auto const& stats = cache->GetStats();
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("Compile cache: {} hits, {} misses ({} corrupt), {} stored.",
+			stats.hits, stats.misses, stats.corrupt, stats.stored);
+	}
+
+	std::vector<ZDrive::Compiler::ObjectModule> modules;
+	for (auto& module : compiled) {
+		if (!module) {
+			ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << "Compilation failed.";
+			exit(65); return;
+		}
+		modules.push_back(std::move(module.value()));
+	}
+
+	linkAndWrite(modules, outPath, entryName);
+}
+
+static void verifyCache(std::string cacheDir, bool removeBad) {
+	ZDrive::Compiler::CompileCache cache(cacheDir);
+	auto result = cache.Verify(removeBad);
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("{} entries ok, {} corrupt, {} removed.", result.ok, result.bad, result.removed);
+	if (result.bad > result.removed) exit(65);
+}
+
+static void compileObjectFile(std::string inPath, std::string outPath) {
+	ZDrive::Compiler::LangDecl lang;
+	lang.DeclareDefaultBaseIns();
+
+	auto module = ZDrive::Compiler::CompileModule(lang, readFileToString(inPath), inPath);
+	if (!module) {
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << "Compilation failed.";
+		exit(65); return;
+	}
+	writeIntsToFile(module.value().Serialize(), outPath);
+}
+
+static void linkToFile(std::vector<std::string> inPaths, std::string outPath, std::string entryName) {
+	std::vector<ZDrive::Compiler::ObjectModule> modules;
+	for (std::string file : inPaths) {
+		auto module = ZDrive::Compiler::ObjectModule::Deserialize(readFileToInts(file));
+		if (!module) {
+			ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << file << " is not an object module, or is from a different version of the compiler.";
+			exit(65); return;
+		}
+		modules.push_back(std::move(module.value()));
+	}
+
+	linkAndWrite(modules, outPath, entryName);
 }
 
 static void runFile(std::string path) {
@@ -116,4 +245,339 @@ static void runFile(std::string path) {
 		}
 	}
 #endif
+}
+
+static void transpileFile(std::string inPath, std::string outPath, std::string tableName) {
+	std::string result = ZDrive::Compiler::Transpile(readFileToInts(inPath), tableName);
+
+	if (result.empty()) {
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << "Transpilation failed.";
+		exit(65); return;
+	} else {
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << "Transpiled sucessfully.";
+	}
+
+	std::fstream outputFile = std::fstream(outPath, std::ios::out | std::ios::binary);
+	outputFile.write(result.data(), result.size());
+	outputFile.close();
+}
+
+static void mineFiles(std::vector<std::string> paths, u32 length) {
+	std::map<std::vector<u32>, u32> counts;
+	for (std::string const& path : paths) {
+		ZDrive::Compiler::MineSequences(readFileToInts(path), length, counts);
+	}
+
+	std::vector<std::pair<std::vector<u32>, u32>> sorted(counts.begin(), counts.end());
+	std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+
+	for (usize i = 0; i < sorted.size() && i < 20; i++) {
+		std::string names;
+		for (u32 opcode : sorted[i].first) {
+			auto op = ZDrive::GetOp(opcode);
+			names += (names.empty() ? "" : ", ") + (op ? std::string(op->name) : std::to_string(opcode));
+		}
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << sorted[i].second << "x " << names;
+	}
+}
+
+static void benchCompile(std::vector<std::string> inPaths, u32 repetitions) {
+	std::string source;
+	for (std::string file : inPaths) {
+		source.append(readFileToString(file));
+	}
+
+	ZDrive::Compiler::LangDecl lang;
+	lang.DeclareDefaultBaseIns();
+
+	// the compiler's debug output would be most of what gets timed otherwise.
+	ZDrive::Logger::SetLevel(ZDrive::Logger::LL::Warn);
+	PROCESS_MEMORY_COUNTERS memBefore{};
+	memBefore.cb = sizeof(memBefore);
+	GetProcessMemoryInfo(GetCurrentProcess(), &memBefore, sizeof(memBefore));
+	usize codeSize = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (u32 i = 0; i < repetitions; i++) {
+		codeSize = ZDrive::Compiler::Compile(lang, source).size();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	ZDrive::Logger::SetLevel(ZDrive::Logger::LL::All);
+
+	double mb = source.size() / (1024.0 * 1024.0);
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("Compiled {:.2f} MB to {} ints {} times in {:.3f}s ({:.2f} MB/s).",
+		mb, codeSize, repetitions, elapsed.count(), mb * repetitions / elapsed.count());
+
+	// the peak is over the whole process, so this is only meaningful if nothing before used more than the compiler does.
+	PROCESS_MEMORY_COUNTERS memAfter{};
+	memAfter.cb = sizeof(memAfter);
+	GetProcessMemoryInfo(GetCurrentProcess(), &memAfter, sizeof(memAfter));
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("Peak working set grew by {:.2f} MB while compiling.",
+		(memAfter.PeakWorkingSetSize - memBefore.WorkingSetSize) / (1024.0 * 1024.0));
+}
+
+// times libm against ZDrive::Math::Det on count angles, and how far each is from the double precision result.
+static void benchMath(u32 count) {
+	namespace Math = ZDrive::Math;
+	std::vector<float> angles(count);
+	std::vector<float> ys(count);
+	std::mt19937 gen(1);
+	std::uniform_real_distribution<float> angle(-64.0f, 64.0f);
+	std::uniform_real_distribution<float> y(-8.0f, 8.0f);
+	for (u32 i = 0; i < count; i++) {
+		angles[i] = angle(gen);
+		ys[i] = y(gen);
+	}
+	std::vector<float> out(count);
+	std::vector<float> out2(count);
+
+	// runs f on every angle and returns <seconds, largest error against ref>.
+	auto measure = [&](auto f, auto ref) {
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < count; i++) out[i] = f(angles[i], ys[i]);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		double err = 0;
+		for (u32 i = 0; i < count; i++) {
+			double e = std::abs(out[i] - ref(static_cast<double>(angles[i]), static_cast<double>(ys[i])));
+			if (e > err) err = e;
+		}
+		return std::pair{ elapsed.count(), err };
+	};
+	auto report = [&](std::string_view name, std::pair<double, double> libm, std::pair<double, double> det) {
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("{:>8}: libm {:.2f} ns, max error {:.3g} | det {:.2f} ns, max error {:.3g}",
+			name, libm.first * 1e9 / count, libm.second, det.first * 1e9 / count, det.second);
+	};
+
+	auto sinRef = [](double x, double) { return std::sin(x); };
+	auto cosRef = [](double x, double) { return std::cos(x); };
+	auto tanRef = [](double x, double) { return std::tan(x); };
+	auto atan2Ref = [](double x, double y) { return std::atan2(y, x); };
+	report("sin", measure([](float x, float) { return sinf(x); }, sinRef), measure([](float x, float) { return Math::Det::sin(x); }, sinRef));
+	report("cos", measure([](float x, float) { return cosf(x); }, cosRef), measure([](float x, float) { return Math::Det::cos(x); }, cosRef));
+	// tan blows up near the poles, so that error is mostly about the input not being exactly representable.
+	report("tan", measure([](float x, float) { return tanf(x); }, tanRef), measure([](float x, float) { return Math::Det::tan(x); }, tanRef));
+	report("atan2", measure([](float x, float y) { return atan2f(y, x); }, atan2Ref), measure([](float x, float y) { return Math::Det::atan2(y, x); }, atan2Ref));
+
+	auto start = std::chrono::steady_clock::now();
+	Math::Det::sinCos(angles, out, out2);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	u32 mismatches = 0;
+	for (u32 i = 0; i < count; i++) {
+		if (out[i] != Math::Det::sin(angles[i]) || out2[i] != Math::Det::cos(angles[i])) mismatches++;
+	}
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("  sinCos: det batch {:.2f} ns per angle, {} differ from one at a time.", elapsed.count() * 1e9 / count, mismatches);
+}
+
+static void benchLockstep(std::string path, bool deterministic) {
+	std::vector<i32> code = readFileToInts(path);
+	if (deterministic) ZDrive::Math::setMode(ZDrive::Math::Mode::DETERMINISTIC);
+
+	// runs the file to the end as fast as it can and returns <seconds, frames>.
+	auto run = [&](bool lockstep) {
+		ZDrive::setRandSeed(12182022);
+		std::vector<i32> errors;
+		ZDrive::VM::ZVMOptions options;
+		options.lockstep = lockstep;
+		ZDrive::VM::ZVM vm(std::vector<i32>(code), errors, options);
+		if (auto diff = vm.GetVarRef(ZDrive::VTID::DIFF); diff) diff.value().get().s = 1;
+		if (auto rank = vm.GetVarRef(ZDrive::VTID::RANK); rank) rank.value().get().s = 1;
+
+		u32 frames = 0;
+		auto start = std::chrono::steady_clock::now();
+		while (!vm.IsFinished()) {
+			vm.Update();
+			frames++;
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return std::pair{ elapsed.count(), frames };
+	};
+
+	auto [single, singleFrames] = run(false);
+	auto [lockstep, lockstepFrames] = run(true);
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("one at a time: {:.3f} s over {} frames | lockstep: {:.3f} s over {} frames ({:.2f}x)",
+		single, singleFrames, lockstep, lockstepFrames, single / lockstep);
+}
+
+static void benchBudget(std::string path, double budgetMs) {
+	std::vector<i32> code = readFileToInts(path);
+
+	// runs the file to the end, logging the slowest frame and how much got put off.
+	auto run = [&](double budget) {
+		ZDrive::setRandSeed(12182022);
+		std::vector<i32> errors;
+		ZDrive::VM::ZVMOptions options;
+		options.frameTimeBudget = budget / 1000;
+		ZDrive::VM::ZVM vm(std::vector<i32>(code), errors, options);
+		if (auto diff = vm.GetVarRef(ZDrive::VTID::DIFF); diff) diff.value().get().s = 1;
+		if (auto rank = vm.GetVarRef(ZDrive::VTID::RANK); rank) rank.value().get().s = 1;
+
+		u32 frames = 0, lateFrames = 0, worstFrame = 0;
+		u64 deferred = 0;
+		double total = 0, worst = 0;
+		while (!vm.IsFinished()) {
+			vm.Update();
+			ZDrive::VM::ZVMFrameReport const& report = vm.GetFrameReport();
+			frames++;
+			total += report.updateTime;
+			if (report.updateTime > worst) {
+				worst = report.updateTime;
+				worstFrame = frames - 1;
+			}
+			deferred += report.deferred;
+			lateFrames += report.deferred != 0;
+		}
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("budget {:.2f} ms: {} frames, {:.3f} ms average, {:.3f} ms worst (frame {}) | {} routine updates put off over {} frames",
+			budget, frames, total * 1000 / max(frames, 1u), worst * 1000, worstFrame, deferred, lateFrames);
+	};
+
+	run(0);
+	run(budgetMs);
+}
+
+static void benchPost(std::string path, u32 posters) {
+	using ZDrive::VM::HostCommand;
+	std::vector<i32> code = readFileToInts(path);
+	ZDrive::setRandSeed(12182022);
+	std::vector<i32> errors;
+	ZDrive::VM::ZVM vm(std::move(code), errors);
+	if (auto diff = vm.GetVarRef(ZDrive::VTID::DIFF); diff) diff.value().get().s = 1;
+	if (auto rank = vm.GetVarRef(ZDrive::VTID::RANK); rank) rank.value().get().s = 1;
+
+	// each thread keeps setting DIFF and RANK to the same bit in one batch, so they never differ between frames unless a batch got split.
+	std::atomic<bool> done = false;
+	std::atomic<u64> posted = 0, dropped = 0;
+	std::vector<std::thread> threads;
+	for (u32 t = 0; t < posters; t++) {
+		threads.emplace_back([&, t]() {
+			for (i32 i = 0; !done.load(std::memory_order_relaxed); i++) {
+				i32 value = 1 << (i + t) % 2;
+				std::array<HostCommand, 2> batch = { HostCommand::SetVar(0, ZDrive::VTID::DIFF, value), HostCommand::SetVar(0, ZDrive::VTID::RANK, value) };
+				if (vm.Post(batch)) posted++;
+				else dropped++;
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		});
+	}
+
+	u32 frames = 0, split = 0;
+	u64 applied = 0;
+	double total = 0, worst = 0;
+	while (!vm.IsFinished()) {
+		vm.Update();
+		ZDrive::VM::ZVMFrameReport const& report = vm.GetFrameReport();
+		frames++;
+		applied += report.commands;
+		total += report.commandLatency * report.commands;
+		worst = max(worst, report.maxCommandLatency);
+		split += vm.GetVar(ZDrive::VTID::DIFF)->s != vm.GetVar(ZDrive::VTID::RANK)->s;
+		// roughly a 60 fps frame, so commands have something to wait for.
+		std::this_thread::sleep_for(std::chrono::microseconds(16667));
+	}
+	done = true;
+	for (std::thread& thread : threads) thread.join();
+
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("{} threads, {} frames: {} commands posted, {} applied, {} dropped | latency {:.3f} ms average, {:.3f} ms worst | {} frames with a split batch",
+		posters, frames, posted.load() * 2, applied, dropped.load(), total * 1000 / max(applied, 1ull), worst * 1000, split);
+}
+
+static void benchSnapshot(std::string path) {
+	std::vector<i32> code = readFileToInts(path);
+
+	// runs the file to the end as fast as it goes, with a thread reading snapshots the whole time like a renderer would.
+	auto run = [&](bool snapshots) {
+		ZDrive::setRandSeed(12182022);
+		std::vector<i32> errors;
+		ZDrive::VM::ZVMOptions options;
+		options.snapshots = snapshots;
+		options.snapshotLayout.x = ZDrive::VTID::F0;
+		options.snapshotLayout.y = ZDrive::VTID::F1;
+		options.snapshotLayout.angle = ZDrive::VTID::F2;
+		ZDrive::VM::ZVM vm(std::vector<i32>(code), errors, options);
+		if (auto diff = vm.GetVarRef(ZDrive::VTID::DIFF); diff) diff.value().get().s = 1;
+		if (auto rank = vm.GetVarRef(ZDrive::VTID::RANK); rank) rank.value().get().s = 1;
+
+		std::atomic<bool> done = false;
+		u32 read = 0, bad = 0;
+		u64 routines = 0;
+		double sum = 0;
+		std::thread renderer;
+		if (snapshots) {
+			renderer = std::thread([&]() {
+				u32 last = UINT32_MAX;
+				while (!done.load(std::memory_order_relaxed)) {
+					ZDrive::VM::FrameSnapshot const& snap = vm.LatestSnapshot();
+					if (snap.frame == last) {
+						std::this_thread::sleep_for(std::chrono::microseconds(500));
+						continue;
+					}
+					// every array the same length, and never an older frame than last time.
+					usize n = snap.size();
+					if (snap.x.size() != n || snap.y.size() != n || snap.angle.size() != n || snap.type.size() != n || snap.flags.size() != n || (last != UINT32_MAX && snap.frame < last)) bad++;
+					for (usize i = 0; i < n; i++) sum += snap.x[i] + snap.y[i];
+					routines += n;
+					last = snap.frame;
+					read++;
+				}
+			});
+		}
+
+		u32 frames = 0;
+		double total = 0, snapshotTotal = 0;
+		while (!vm.IsFinished()) {
+			vm.Update();
+			frames++;
+			total += vm.GetFrameReport().updateTime;
+			snapshotTotal += vm.GetFrameReport().snapshotTime;
+		}
+		done = true;
+		if (renderer.joinable()) renderer.join();
+
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << std::format("snapshots {}: {} frames, {:.3f} ms average, {:.3f} ms of it taking the snapshot | {} snapshots read, {:.1f} routines each, {} bad (checksum {:.3f})",
+			snapshots ? "on" : "off", frames, total * 1000 / max(frames, 1u), snapshotTotal * 1000 / max(frames, 1u), read, routines / double(max(read, 1u)), bad, sum);
+	};
+
+	run(false);
+	run(true);
+}
+
+// clones start where their template's first update stopped, which is at the first instruction after time -1. When that's a
+// wait_change, each clone has to wait for its own value of the var to change, not the template's. Exits with 65 if they get through early or never wake.
+static void testWaitChange() {
+	constexpr u32 IN2 = ZDrive::VTID::IN0 + 2;
+	std::string source = std::format(
+		"bind IN2 {};\n"
+		"sub waiter() {{\n"
+		"\t@-1:\n"
+		"\twait_change(IN2);\n"
+		"}}\n"
+		"sub main() {{\n"
+		"\temit_ring(waiter, 4, 0.0, 5.0);\n"
+		"}}\n", IN2);
+
+	ZDrive::Compiler::LangDecl lang;
+	lang.DeclareDefaultBaseIns();
+	std::vector<i32> errors;
+	// lazily, so waiter's template is only built once RANK is set. It'd be masked out while loading otherwise.
+	ZDrive::VM::ZVMOptions options;
+	options.templateLoading = ZDrive::VM::TemplateLoading::LAZY;
+	ZDrive::VM::ZVM vm(ZDrive::Compiler::Compile(lang, source, "main"), errors, options);
+	if (auto diff = vm.GetVarRef(ZDrive::VTID::DIFF); diff) diff.value().get().s = 1;
+	if (auto rank = vm.GetVarRef(ZDrive::VTID::RANK); rank) rank.value().get().s = 1;
+
+	for (u32 i = 0; i < 10; i++) vm.Update();
+	std::vector<u32> waiters;
+	for (u32 instance = 1; instance <= 8; instance++) {
+		if (auto rt = vm.GetRoutineByInstance(instance); rt && rt->get().IsBlocked()) waiters.push_back(instance);
+	}
+	if (vm.IsFinished() || waiters.size() != 4) {
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << std::format("{} of 4 waiters still waiting after 10 frames.", waiters.size());
+		exit(65); return;
+	}
+
+	for (u32 instance : waiters) vm.Post(ZDrive::VM::HostCommand::SetVar(instance, IN2, 6.0f));
+	for (u32 i = 0; i < 3 && !vm.IsFinished(); i++) vm.Update();
+	if (!vm.IsFinished()) {
+		ZDrive::Logger::Log(ZDrive::Logger::LL::Fatal) << "The waiters didn't wake when their var changed.";
+		exit(65); return;
+	}
+	ZDrive::Logger::Log(ZDrive::Logger::LL::Info) << "wait_change ok.";
 }
\ No newline at end of file
@@ -5,9 +5,13 @@
 #include <cmath>
 #include <corecrt_math_defines.h> // lazy? makes more sense to me than _USE_MATH_DEFINES, which for some reason wasn't working.
 
+#include <array>
 #include <format>
 #include <optional>
+#include <span>
+#include <string_view>
 #include <time.h>
+#include <type_traits>
 #include <utility>
 
 #include <string>
@@ -21,7 +25,10 @@
 #include "ZDriveCommon/Core.hpp"
 #include "ZDriveCommon/Logger.hpp"
 #include "ZDriveCommon/Random.hpp"
+#include "ZDriveCommon/Math.hpp"
 #include "ZDriveCommon/Enums.hpp"
+#include "ZDriveCommon/OpTable.hpp"
 #include "ZDriveCommon/Structs.hpp"
+#include "ZDriveCommon/Hash.hpp"
 
 #include "ZDriveCommon/Lang.hpp"
\ No newline at end of file
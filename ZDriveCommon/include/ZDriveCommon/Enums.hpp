@@ -21,6 +21,12 @@ namespace ZDrive {
 		enum AT : i32 {
 			CNST, VTREF,
 			TEMP_LABEL = -1,
+			// a call to a sub whose id isn't known until link time.
+			TEMP_SUB = -2,
+			// a temporary of an expression, written as the id of a var to write or a ref to read.
+			// The compiler picks which LI/LF slot it is once the whole sub is known.
+			TEMP_VAR = -3,
+			TEMP_VAR_REF = -4,
 		};
 	}
 	namespace AT = ArgType;
@@ -114,8 +120,40 @@ namespace ZDrive {
 			ASSERT_PTR,
 			SET_PRIORITY,
 
+			// superinstructions. The compiler fuses common sequences into these, they aren't meant to be written by hand.
+			CALL_ARGS, // set OUT0..OUTn to args 1..n+1, then call arg 0
+			DEC_JMP, // idec arg 0, then the int jump in arg 1 to arg 2 at time arg 3 if $arg0 compares to arg 4
+			CIRCLEPOS_ADD, // mathCirclePos with args 0-3, then fadd the results into args 4 and 5
+
+			// blocking waits. The routine isn't updated again until a var it waits on is written, see ZVM::Block.
+			WAIT_CHANGE, // until the var with id arg 0 holds something else
+			WAIT_UNTIL, // jump to args 0-1 and try again for as long as the jump in arg 2 would be taken on args 3-5. Args after that are the ids of the vars read to get there
+
+			// emitters. Spawn arg 1 instances of sub arg 0 in one go, each with its index in IN0, an angle in IN1 and the speed (the last arg) in IN2.
+			EMIT_RING, // angles evenly around a circle, starting at arg 2
+			EMIT_FAN, // angles evenly over an arc of arg 3 centred on arg 2, ends included
+			EMIT_SPREAD, // random angles within an arc of arg 3 centred on arg 2
+			EMIT_AIMED, // like EMIT_FAN, centred on the direction of the vector (arg 2, arg 3) with an arc of arg 4
+
+			// 2D vectors. A vector arg is the id of its x, and y is the var after it, eg. 17 for F0 and F1.
+			V2ADD, // vector arg 0 += vector arg 1
+			V2SCALE, // vector arg 0 *= arg 1
+			V2ROTATE, // rotate vector arg 0 by arg 1 radians
+			V2POLAR_ADD, // vector arg 0 += (arg 1 * cos(arg 2), arg 1 * sin(arg 2))
+			V2NORMALIZE, // vector arg 0 /= its length, a zero vector stays zero
+			V2LENGTH, // arg 0 = length of vector arg 1
+			V2DOT, // arg 0 = vector arg 1 . vector arg 2
+
+			// groups, see ZVM::SetGroup. Group 0 is no group, so these do nothing with it.
+			SET_GROUP, // move this routine into group arg 0
+			KILL_GROUP, // delete every routine in group arg 0
+			SUSPEND_GROUP, // stop updating every routine in group arg 0
+			RESUME_GROUP, // update every routine in group arg 0 again
+			SET_GROUP_PRIORITY, // set the priority of every routine in group arg 0 to arg 1
+
+			SET_DEFERRABLE, // whether this routine may be put off to a later frame when the VM is running late (arg 0 != 0), see ZVMOptions::frameTimeBudget
 			BASE_FIRST = NOP,
-			BASE_LAST = SET_PRIORITY,
+			BASE_LAST = SET_DEFERRABLE,
 		};
 	}
 	namespace INS = BaseOpCode;
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace ZDrive {
+	// 64 bit FNV-1a. Not cryptographic, only used to tell whether something has changed.
+	class Hasher {
+	public:
+		Hasher& add(void const* data, usize size);
+		inline Hasher& add(std::string_view str) { return add(str.data(), str.size()); }
+		template <typename T> requires std::is_trivially_copyable_v<T>
+		inline Hasher& add(std::span<const T> span) { return add(span.data(), span.size_bytes()); }
+
+		inline u64 get() const { return state; }
+	private:
+		u64 state = 14695981039346656037ull;
+	};
+
+	// checksum of a sub's bytecode, eg. to check that transpiled code still matches the script it came from.
+	inline u64 hashCode(std::span<const i32> code) { return Hasher().add(code).get(); }
+}
\ No newline at end of file
@@ -43,6 +43,16 @@ namespace ZDrive {
 		/// <param name="outputDest">Where the log should output to.</param>
 		void SetOutput(std::ostream& outputDest);
 		/// <summary>
+		/// Sends messages logged from the calling thread to outputDest instead, so threads logging at once don't interleave.
+		/// Pass nullptr to go back to the shared output. What was captured can be passed to Write afterwards.
+		/// </summary>
+		/// <param name="outputDest">Where the calling thread's log should output to.</param>
+		void SetThreadOutput(std::ostream* outputDest);
+		/// <summary>
+		/// Writes text to the shared output as is, without a prefix.
+		/// </summary>
+		void Write(std::string_view text);
+		/// <summary>
 		/// Resets the high-resolution time source.
 		/// </summary>
 		void ResetClock();
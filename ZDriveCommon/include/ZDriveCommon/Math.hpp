@@ -0,0 +1,36 @@
+#pragma once
+
+namespace ZDrive::Math {
+	enum class Mode : u8 {
+		LIBM, // the C library's functions. Results can differ between C libraries, so replays may not hold up across machines
+		DETERMINISTIC, // the Det functions below, which give the same bits everywhere
+	};
+	// which one the functions below go to. Global like the rng, so set it before anything runs (eg. along with setRandSeed) and leave it.
+	void setMode(Mode mode);
+	Mode getMode();
+
+	f32 sin(f32 x);
+	f32 cos(f32 x);
+	f32 tan(f32 x);
+	f32 atan2(f32 y, f32 x);
+	f32 sqrt(f32 x);
+	// x wrapped into [-pi, pi]
+	f32 normRad(f32 x);
+	// sin and cos of every angle in x. Stops at the shortest of the three.
+	void sinCos(std::span<const f32> x, std::span<f32> sinOut, std::span<f32> cosOut);
+
+	// range reduced polynomials that only use operations IEEE 754 rounds exactly, so they're bit reproducible on any machine
+	// (as long as the compiler doesn't contract them into FMAs or reorder them, ie. no /fp:fast).
+	// sin, cos and tan are within a few ulp up to about 1e5 radians. Past that they're still reproducible, just less accurate.
+	namespace Det {
+		f32 sin(f32 x);
+		f32 cos(f32 x);
+		f32 tan(f32 x);
+		f32 atan2(f32 y, f32 x);
+		// IEEE 754 requires sqrt and remainder to be exact, so these are the C library's.
+		f32 sqrt(f32 x);
+		f32 normRad(f32 x);
+		// four at a time with SSE2 where there is one. Same bits as sin and cos one at a time.
+		void sinCos(std::span<const f32> x, std::span<f32> sinOut, std::span<f32> cosOut);
+	}
+}
\ No newline at end of file
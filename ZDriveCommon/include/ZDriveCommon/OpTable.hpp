@@ -0,0 +1,251 @@
+#pragma once
+
+namespace ZDrive {
+	// what an instruction does with one of its args.
+	enum class OperandKind : u8 {
+		VAL, // read as a value
+		DEST, // id of a variable that gets written
+		INOUT, // id of a variable that gets read, then written
+		POS, // offset of an instruction in the same sub
+		TIME, // what CLOCK is set to when jumping
+		SUB, // id of a sub
+		OPCODE, // another instruction's opcode
+	};
+
+	namespace OpFlags {
+		enum : u8 {
+			NONE = 0,
+			JUMPS = 1 << 0, // can change which instruction runs next
+			STOPS = 1 << 1, // ends the routine's update
+			SPAWNS = 1 << 2, // creates other routines
+			REMOTE = 1 << 3, // looks at other routines
+			RANDOM = 1 << 4, // draws from the rng itself, on top of any RAND args
+			OUTPUT = 1 << 5, // has effects outside the VM
+			VM_STATE = 1 << 6, // changes how the VM runs routines
+			INTERNAL = 1 << 7, // only emitted by the compiler, not part of the language
+		};
+	}
+
+	struct OpInfo {
+		static constexpr u32 MAX_OPERANDS = 7;
+
+		std::string_view name;
+		u32 code = 0;
+		// how many args are read. Fewer is an error, more are ignored (unless variadic).
+		u8 arity = 0;
+		// whether any number of VAL args may follow the fixed ones.
+		bool variadic = false;
+		u8 flags = OpFlags::NONE;
+		std::array<OperandKind, MAX_OPERANDS> operands{};
+
+		constexpr bool has(u8 flag) const { return flags & flag; }
+		// index of the first operand of this kind.
+		constexpr std::optional<u32> operand(OperandKind kind) const {
+			for (u32 i = 0; i < arity; i++) if (operands[i] == kind) return i;
+			return std::nullopt;
+		}
+		// whether the first operand is the id of a variable that gets written.
+		constexpr bool hasDest() const { return arity > 0 && (operands[0] == OperandKind::DEST || operands[0] == OperandKind::INOUT); }
+	};
+
+	namespace OpTableDetail {
+		constexpr OpInfo op(u32 code, std::string_view name, u8 flags, std::initializer_list<OperandKind> operands, bool variadic = false) {
+			OpInfo ret{ name, code, static_cast<u8>(operands.size()), variadic, flags };
+			u32 i = 0;
+			for (OperandKind kind : operands) ret.operands[i++] = kind;
+			return ret;
+		}
+
+		constexpr OperandKind V = OperandKind::VAL;
+		constexpr OperandKind D = OperandKind::DEST;
+		constexpr OperandKind IO = OperandKind::INOUT;
+		constexpr OperandKind P = OperandKind::POS;
+		constexpr OperandKind T = OperandKind::TIME;
+		constexpr OperandKind S = OperandKind::SUB;
+		constexpr OperandKind OC = OperandKind::OPCODE;
+		using namespace OpFlags;
+	}
+
+	// every base instruction, indexed by opcode. The compiler's language, the VM's verifier and compiled tier,
+	// the transpiler and the disassembler all read arities and names from here.
+	inline constexpr std::array<OpInfo, INS::BASE_LAST + 1> OPS = []() {
+		using namespace OpTableDetail;
+		return std::array<OpInfo, INS::BASE_LAST + 1>{
+			op(INS::NOP, "nop", NONE, {}),
+			op(INS::RET, "ret", STOPS, {}),
+			op(INS::WAIT, "wait", NONE, { V }),
+			op(INS::JMP, "jmp", JUMPS, { P, T }),
+			op(INS::LOOP, "loop", JUMPS, { P, T, IO }),
+			op(INS::SET, "set", NONE, { D, V }),
+			op(INS::ISET, "iset", NONE, { D, V }),
+			op(INS::FSET, "fset", NONE, { D, V }),
+			op(INS::ISET_RAND_SIGN, "iset_rand_sign", RANDOM, { D, V }),
+			op(INS::FSET_RAND_SIGN, "fset_rand_sign", RANDOM, { D, V }),
+			op(INS::IADD, "iadd", NONE, { IO, V }),
+			op(INS::ISUB, "isub", NONE, { IO, V }),
+			op(INS::IMUL, "imul", NONE, { IO, V }),
+			op(INS::IDIV, "idiv", NONE, { IO, V }),
+			op(INS::IMOD, "imod", NONE, { IO, V }),
+			op(INS::IMOD2, "imod2", NONE, { IO, V }),
+			op(INS::FADD, "fadd", NONE, { IO, V }),
+			op(INS::FSUB, "fsub", NONE, { IO, V }),
+			op(INS::FMUL, "fmul", NONE, { IO, V }),
+			op(INS::FDIV, "fdiv", NONE, { IO, V }),
+			op(INS::FMOD, "fmod", NONE, { IO, V }),
+			op(INS::FMOD2, "fmod2", NONE, { IO, V }),
+			op(INS::ISET_ADD, "iset_add", NONE, { D, V, V }),
+			op(INS::ISET_SUB, "iset_sub", NONE, { D, V, V }),
+			op(INS::ISET_MUL, "iset_mul", NONE, { D, V, V }),
+			op(INS::ISET_DIV, "iset_div", NONE, { D, V, V }),
+			op(INS::ISET_MOD, "iset_mod", NONE, { D, V, V }),
+			op(INS::FSET_ADD, "fset_add", NONE, { D, V, V }),
+			op(INS::FSET_SUB, "fset_sub", NONE, { D, V, V }),
+			op(INS::FSET_MUL, "fset_mul", NONE, { D, V, V }),
+			op(INS::FSET_DIV, "fset_div", NONE, { D, V, V }),
+			op(INS::FSET_MOD, "fset_mod", NONE, { D, V, V }),
+			op(INS::IINC, "iinc", NONE, { IO }),
+			op(INS::FINC, "finc", NONE, { IO }),
+			op(INS::IDEC, "idec", NONE, { IO }),
+			op(INS::FDEC, "fdec", NONE, { IO }),
+			op(INS::FSET_SIN, "fset_sin", NONE, { D, V }),
+			op(INS::FSET_COS, "fset_cos", NONE, { D, V }),
+			op(INS::FSET_TAN, "fset_tan", NONE, { D, V }),
+			op(INS::FSET_ANGLE, "fset_angle", NONE, { D, V, V, V, V }),
+			op(INS::FINTERP, "finterp", SPAWNS, { D, V, V, V, V, V, V }),
+			op(INS::NORMRAD, "normRad", NONE, { IO }),
+			op(INS::MATHCIRCLEPOS, "mathCirclePos", NONE, { D, D, V, V }),
+			op(INS::MATHDISTANCE, "mathDistance", NONE, { D, V, V, V, V }),
+			op(INS::JMP_EQU, "jmp_equ", JUMPS, { P, T, V, V }),
+			op(INS::JMP_EQU_F, "jmp_equ_f", JUMPS, { P, T, V, V, V }),
+			op(INS::JMP_NEQ, "jmp_neq", JUMPS, { P, T, V, V }),
+			op(INS::JMP_NEQ_F, "jmp_neq_f", JUMPS, { P, T, V, V, V }),
+			op(INS::JMP_LT, "jmp_lt", JUMPS, { P, T, V, V }),
+			op(INS::JMP_LT_F, "jmp_lt_f", JUMPS, { P, T, V, V }),
+			op(INS::JMP_LTE, "jmp_lte", JUMPS, { P, T, V, V }),
+			op(INS::JMP_LTE_F, "jmp_lte_f", JUMPS, { P, T, V, V, V }),
+			op(INS::JMP_GT, "jmp_gt", JUMPS, { P, T, V, V }),
+			op(INS::JMP_GT_F, "jmp_gt_f", JUMPS, { P, T, V, V }),
+			op(INS::JMP_GTE, "jmp_gte", JUMPS, { P, T, V, V }),
+			op(INS::JMP_GTE_F, "jmp_gte_f", JUMPS, { P, T, V, V, V }),
+			op(INS::CALL, "call", SPAWNS, { S }),
+			op(INS::YEILD, "yeild", STOPS, {}),
+			op(INS::PRINT, "print", OUTPUT, { V, V, V }),
+			op(INS::SET_PTR, "set_ptr", NONE, { D, V }),
+			op(INS::ASSERT_PTR, "assert_ptr", REMOTE, { V, D }),
+			op(INS::SET_PRIORITY, "set_priority", VM_STATE, { V }),
+			op(INS::CALL_ARGS, "call_args", SPAWNS | INTERNAL, { S }, true),
+			op(INS::DEC_JMP, "dec_jmp", JUMPS | INTERNAL, { IO, OC, P, T, V }),
+			op(INS::CIRCLEPOS_ADD, "circlepos_add", INTERNAL, { D, D, V, V, IO, IO }),
+			op(INS::WAIT_CHANGE, "wait_change", STOPS | REMOTE, { V }),
+			op(INS::WAIT_UNTIL, "wait_until", JUMPS | STOPS | REMOTE | INTERNAL, { P, T, OC, V, V, V }, true),
+			op(INS::EMIT_RING, "emit_ring", SPAWNS, { S, V, V, V }),
+			op(INS::EMIT_FAN, "emit_fan", SPAWNS, { S, V, V, V, V }),
+			op(INS::EMIT_SPREAD, "emit_spread", SPAWNS | RANDOM, { S, V, V, V, V }),
+			op(INS::EMIT_AIMED, "emit_aimed", SPAWNS, { S, V, V, V, V, V }),
+			op(INS::V2ADD, "v2add", NONE, { IO, V }),
+			op(INS::V2SCALE, "v2scale", NONE, { IO, V }),
+			op(INS::V2ROTATE, "v2rotate", NONE, { IO, V }),
+			op(INS::V2POLAR_ADD, "v2polar_add", NONE, { IO, V, V }),
+			op(INS::V2NORMALIZE, "v2normalize", NONE, { IO }),
+			op(INS::V2LENGTH, "v2length", NONE, { D, V }),
+			op(INS::V2DOT, "v2dot", NONE, { D, V, V }),
+			op(INS::SET_GROUP, "set_group", VM_STATE, { V }),
+			op(INS::KILL_GROUP, "kill_group", REMOTE | VM_STATE, { V }),
+			op(INS::SUSPEND_GROUP, "suspend_group", REMOTE | VM_STATE, { V }),
+			op(INS::RESUME_GROUP, "resume_group", REMOTE | VM_STATE, { V }),
+			op(INS::SET_GROUP_PRIORITY, "set_group_priority", REMOTE | VM_STATE, { V, V }),
+			op(INS::SET_DEFERRABLE, "set_deferrable", VM_STATE, { V }),
+		};
+	}();
+
+	// whether arg i of the instruction is a 2D vector, ie. the id of a var that's used along with the one after it.
+	constexpr bool isVec2Arg(u32 opcode, u32 i) {
+		switch (opcode) {
+		case INS::V2ADD: return i < 2;
+		case INS::V2SCALE: case INS::V2ROTATE: case INS::V2POLAR_ADD: case INS::V2NORMALIZE: return i == 0;
+		case INS::V2LENGTH: return i == 1;
+		case INS::V2DOT: return i == 1 || i == 2;
+		default: return false;
+		}
+	}
+
+	namespace OpTableDetail {
+		constexpr u32 hash(std::string_view str, u32 seed) {
+			u32 h = 2166136261u ^ (seed * 0x9e3779b9u);
+			for (char c : str) {
+				h ^= static_cast<u8>(c);
+				h *= 16777619u;
+			}
+			return h ^ (h >> 15);
+		}
+
+		// hash and displace: names are split into buckets by one hash, then each bucket gets a seed
+		// for a second hash that sends all its names to free slots.
+		struct PerfectHash {
+			static constexpr u32 BUCKETS = 32;
+			static constexpr u32 SLOTS = 128;
+			std::array<u32, BUCKETS> seeds{};
+			// opcode + 1, 0 if empty.
+			std::array<u16, SLOTS> slots{};
+		};
+
+		constexpr PerfectHash buildPerfectHash() {
+			constexpr u32 B = PerfectHash::BUCKETS;
+			constexpr u32 N = static_cast<u32>(OPS.size());
+			static_assert(N < PerfectHash::SLOTS, "grow PerfectHash::SLOTS");
+
+			PerfectHash ret;
+			std::array<std::array<u32, N>, B> members{};
+			std::array<u32, B> counts{};
+			for (u32 i = 0; i < N; i++) {
+				u32 b = hash(OPS[i].name, 0) % B;
+				members[b][counts[b]++] = i;
+			}
+
+			// biggest buckets first, while there's the most room.
+			std::array<u32, B> order{};
+			for (u32 i = 0; i < B; i++) order[i] = i;
+			for (u32 i = 0; i < B; i++) {
+				for (u32 j = i + 1; j < B; j++) {
+					if (counts[order[j]] > counts[order[i]]) std::swap(order[i], order[j]);
+				}
+			}
+
+			for (u32 b : order) {
+				if (counts[b] == 0) break;
+				for (u32 seed = 1;; seed++) {
+					// throwing here fails compilation, which is what should happen if two ops share a name.
+					if (seed > 100000) throw "no perfect hash found";
+					std::array<u32, N> taken{};
+					bool fits = true;
+					for (u32 i = 0; i < counts[b] && fits; i++) {
+						taken[i] = hash(OPS[members[b][i]].name, seed) % PerfectHash::SLOTS;
+						if (ret.slots[taken[i]]) fits = false;
+						for (u32 j = 0; j < i && fits; j++) if (taken[j] == taken[i]) fits = false;
+					}
+					if (!fits) continue;
+					ret.seeds[b] = seed;
+					for (u32 i = 0; i < counts[b]; i++) ret.slots[taken[i]] = static_cast<u16>(members[b][i] + 1);
+					break;
+				}
+			}
+			return ret;
+		}
+
+		inline constexpr PerfectHash OP_HASH = buildPerfectHash();
+	}
+
+	// nullptr if code isn't a base instruction.
+	constexpr OpInfo const* GetOp(u32 code) {
+		return code < OPS.size() ? &OPS[code] : nullptr;
+	}
+
+	// nullptr if there's no base instruction with that name. Two hashes, one compare, no allocation.
+	constexpr OpInfo const* FindOp(std::string_view name) {
+		using namespace OpTableDetail;
+		u32 seed = OP_HASH.seeds[hash(name, 0) % PerfectHash::BUCKETS];
+		u16 entry = OP_HASH.slots[hash(name, seed) % PerfectHash::SLOTS];
+		if (entry == 0 || OPS[entry - 1].name != name) return nullptr;
+		return &OPS[entry - 1];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#include "ZDriveCommon.hpp"
+
+namespace ZDrive {
+	Hasher& Hasher::add(void const* data, usize size) {
+		u8 const* bytes = static_cast<u8 const*>(data);
+		for (usize i = 0; i < size; i++) {
+			state ^= bytes[i];
+			state *= 1099511628211ull;
+		}
+		return *this;
+	}
+}
\ No newline at end of file
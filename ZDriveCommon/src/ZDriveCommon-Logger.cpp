@@ -12,7 +12,9 @@ namespace ZDrive {
 		_Logger(std::ostream& os) : os(os.rdbuf()) {}
 
 		bool initialized = false;
-		char prefixStr[prefixStrBufferSize];
+		// per thread, since any thread may be building a prefix.
+		static thread_local char prefixStr[prefixStrBufferSize];
+		static thread_local std::ostream* threadOs;
 		std::ostream os;
 		LARGE_INTEGER freq = { 0 };
 		LARGE_INTEGER start_t = { 0 };
@@ -48,12 +50,27 @@ namespace ZDrive {
 
 		std::ostream& _Log(LogLevel _level) {
 			if (!initialized) _Initialize(level, os);
-			if (_level < level) return TGLib::nullout;
-			os << std::endl;
-			return os << "[" << getPrefixString(LTF::DEFAULT, _level) << "] ";
+			std::ostream& out = threadOs ? *threadOs : os;
+			if (_level < level) return threadOs ? threadNullout() : TGLib::nullout;
+			out << std::endl;
+			return out << "[" << getPrefixString(LTF::DEFAULT, _level) << "] ";
+		}
+
+		void _SetThreadOutput(std::ostream* outputDest) {
+			threadOs = outputDest;
+		}
+
+		void _Write(std::string_view text) {
+			if (!initialized) _Initialize(level, os);
+			os << text;
 		}
 
 	private:
+		// nullout is shared, and writing to it still touches its state.
+		static std::ostream& threadNullout() {
+			static thread_local std::ostream nullout(nullptr);
+			return nullout;
+		}
 
 		const char* getPrefixString(TimeFormat ltf, LogLevel _level) {
 			time_t tt = { 0 };
@@ -95,6 +112,9 @@ namespace ZDrive {
 		}
 	} instance;
 
+	thread_local char _Logger::prefixStr[_Logger::prefixStrBufferSize];
+	thread_local std::ostream* _Logger::threadOs = nullptr;
+
 	constexpr const char* Logger::LogLevelToString(LogLevel _level) {
 		switch (_level) {
 		case LL::Debug: return "DEBUG";
@@ -111,6 +131,8 @@ namespace ZDrive {
 	void Logger::Initialize(LogLevel level, std::ostream& outputDest) { return instance._Initialize(level, outputDest); }
 	void Logger::SetLevel(LogLevel level) { return instance._SetLevel(level); }
 	void Logger::SetOutput(std::ostream& outputDest) { return instance._SetOutput(outputDest); }
+	void Logger::SetThreadOutput(std::ostream* outputDest) { return instance._SetThreadOutput(outputDest); }
+	void Logger::Write(std::string_view text) { return instance._Write(text); }
 	void Logger::ResetClock() { return instance._ResetClock(); }
 	std::ostream& Logger::Log(LogLevel level) { return instance._Log(level); }
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "ZDriveCommon.hpp"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ZDRIVE_MATH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ZDrive::Math {
+	namespace {
+		Mode mode = Mode::LIBM;
+
+		constexpr f32 PI = 3.14159265358979323846f;
+		constexpr f32 PI_2 = 1.57079632679489661923f;
+		constexpr f32 PI_4 = 0.785398163397448309616f;
+		constexpr f32 TWO_OVER_PI = 0.636619772367581343076f;
+		// pi/2 in three parts with few enough bits that k * part is exact for any k the float reduction is used for.
+		constexpr f32 PIO2_1 = 1.5703125f;
+		constexpr f32 PIO2_2 = 4.837512969970703125e-4f;
+		constexpr f32 PIO2_3 = 7.54978995489188216e-8f;
+		// past this k * PIO2_1 isn't exact anymore.
+		constexpr f32 REDUCE_LIMIT = 65536.0f;
+		// adding then subtracting this rounds to the nearest integer, for anything under 2^22.
+		constexpr f32 ROUND = 12582912.0f;
+
+		// the cephes polynomials, for r in [-pi/4, pi/4] and z = r*r.
+		constexpr f32 S1 = -1.6666654611e-1f, S2 = 8.3321608736e-3f, S3 = -1.9515295891e-4f;
+		constexpr f32 C1 = 4.166664568298827e-2f, C2 = -1.388731625493765e-3f, C3 = 2.443315711809948e-5f;
+		constexpr f32 A1 = -3.33329491539e-1f, A2 = 1.99777106478e-1f, A3 = -1.38776856032e-1f, A4 = 8.05374449538e-2f;
+
+		inline f32 sinPoly(f32 r, f32 z) { return ((S3 * z + S2) * z + S1) * z * r + r; }
+		inline f32 cosPoly(f32 z) { return ((C3 * z + C2) * z + C1) * z * z - 0.5f * z + 1.0f; }
+
+		// x = k*pi/2 + r. Returns r, only the bottom two bits of k are meaningful.
+		inline f32 reduce(f32 x, i32& k) {
+			if (std::fabs(x) < REDUCE_LIMIT) {
+				f32 kf = (x * TWO_OVER_PI + ROUND) - ROUND;
+				k = static_cast<i32>(kf);
+				return ((x - kf * PIO2_1) - kf * PIO2_2) - kf * PIO2_3;
+			}
+			k = 0;
+			if (!std::isfinite(x)) return x - x;
+			// wrapped into [-pi, pi] first. remainder is exact so this is still reproducible, but 2pi isn't, so the error grows with x.
+			return reduce(static_cast<f32>(std::remainder(static_cast<f64>(x), 6.283185307179586476925)), k);
+		}
+
+		inline void sinCosOne(f32 x, f32& s, f32& c) {
+			i32 k;
+			f32 r = reduce(x, k);
+			f32 z = r * r;
+			f32 sp = sinPoly(r, z);
+			f32 cp = cosPoly(z);
+			// sin goes sp, cp, -sp, -cp around the quadrants and cos goes cp, -sp, -cp, sp.
+			s = k & 1 ? cp : sp;
+			c = k & 1 ? sp : cp;
+			if (k & 2) s = -s;
+			if ((k + 1) & 2) c = -c;
+		}
+
+		// for x in [0, inf).
+		inline f32 atanPos(f32 x) {
+			f32 base = 0;
+			if (x > 2.414213562373095f) {
+				base = PI_2;
+				x = -1.0f / x;
+			} else if (x > 0.4142135623730950f) {
+				base = PI_4;
+				x = (x - 1.0f) / (x + 1.0f);
+			}
+			f32 z = x * x;
+			return base + ((((A4 * z + A3) * z + A2) * z + A1) * z * x + x);
+		}
+	}
+
+	void setMode(Mode newMode) { mode = newMode; }
+	Mode getMode() { return mode; }
+
+	f32 sin(f32 x) { return mode == Mode::DETERMINISTIC ? Det::sin(x) : std::sin(x); }
+	f32 cos(f32 x) { return mode == Mode::DETERMINISTIC ? Det::cos(x) : std::cos(x); }
+	f32 tan(f32 x) { return mode == Mode::DETERMINISTIC ? Det::tan(x) : std::tan(x); }
+	f32 atan2(f32 y, f32 x) { return mode == Mode::DETERMINISTIC ? Det::atan2(y, x) : std::atan2(y, x); }
+	f32 sqrt(f32 x) { return std::sqrt(x); }
+	f32 normRad(f32 x) { return std::remainder(x, PI * 2); }
+
+	void sinCos(std::span<const f32> x, std::span<f32> sinOut, std::span<f32> cosOut) {
+		if (mode == Mode::DETERMINISTIC) return Det::sinCos(x, sinOut, cosOut);
+		usize n = min(x.size(), min(sinOut.size(), cosOut.size()));
+		for (usize i = 0; i < n; i++) {
+			sinOut[i] = std::sin(x[i]);
+			cosOut[i] = std::cos(x[i]);
+		}
+	}
+
+	namespace Det {
+		f32 sin(f32 x) {
+			f32 s, c;
+			sinCosOne(x, s, c);
+			return s;
+		}
+
+		f32 cos(f32 x) {
+			f32 s, c;
+			sinCosOne(x, s, c);
+			return c;
+		}
+
+		f32 tan(f32 x) {
+			f32 s, c;
+			sinCosOne(x, s, c);
+			return s / c;
+		}
+
+		f32 atan2(f32 y, f32 x) {
+			if (std::isnan(x) || std::isnan(y)) return x + y;
+			f32 ax = std::fabs(x);
+			f32 ay = std::fabs(y);
+			f32 a;
+			if (ax == 0 && ay == 0) a = 0;
+			else if (std::isinf(ax) && std::isinf(ay)) a = PI_4;
+			else if (ay <= ax) a = atanPos(ay / ax);
+			else a = PI_2 - atanPos(ax / ay);
+			// same signs as the C library, eg. atan2(+-0, -0) is +-pi.
+			if (std::signbit(x)) a = PI - a;
+			return std::copysign(a, y);
+		}
+
+		f32 sqrt(f32 x) { return std::sqrt(x); }
+		f32 normRad(f32 x) { return std::remainder(x, PI * 2); }
+
+		void sinCos(std::span<const f32> x, std::span<f32> sinOut, std::span<f32> cosOut) {
+			usize n = min(x.size(), min(sinOut.size(), cosOut.size()));
+			usize i = 0;
+#ifdef ZDRIVE_MATH_SSE2
+			// the same operations as sinCosOne in the same order, just on four lanes.
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+			const __m128i one = _mm_set1_epi32(1);
+			const __m128i two = _mm_set1_epi32(2);
+			auto mul = [](__m128 a, f32 b) { return _mm_mul_ps(a, _mm_set1_ps(b)); };
+			auto add = [](__m128 a, f32 b) { return _mm_add_ps(a, _mm_set1_ps(b)); };
+			auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+			for (; i + 4 <= n; i += 4) {
+				__m128 v = _mm_loadu_ps(&x[i]);
+				// anything big (or not finite) takes the slow reduction, so the whole group goes one at a time.
+				if (_mm_movemask_ps(_mm_cmplt_ps(_mm_and_ps(v, absMask), _mm_set1_ps(REDUCE_LIMIT))) != 0xf) {
+					for (usize j = i; j < i + 4; j++) sinCosOne(x[j], sinOut[j], cosOut[j]);
+					continue;
+				}
+				__m128 kf = _mm_sub_ps(add(mul(v, TWO_OVER_PI), ROUND), _mm_set1_ps(ROUND));
+				__m128i k = _mm_cvttps_epi32(kf);
+				__m128 r = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(v, mul(kf, PIO2_1)), mul(kf, PIO2_2)), mul(kf, PIO2_3));
+				__m128 z = _mm_mul_ps(r, r);
+				__m128 sp = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(add(_mm_mul_ps(add(mul(z, S3), S2), z), S1), z), r), r);
+				__m128 cp = add(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(add(_mm_mul_ps(add(mul(z, C3), C2), z), C1), z), z), mul(z, 0.5f)), 1.0f);
+
+				__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(k, one), one));
+				__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(k, two), 30));
+				__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(k, one), two), 30));
+				_mm_storeu_ps(&sinOut[i], _mm_xor_ps(select(swap, cp, sp), sinSign));
+				_mm_storeu_ps(&cosOut[i], _mm_xor_ps(select(swap, sp, cp), cosSign));
+			}
+#endif
+			for (; i < n; i++) sinCosOne(x[i], sinOut[i], cosOut[i]);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "ZDriveCommon.hpp"
+
+// everything about the table is checked here once, so a mistake in it fails the build instead of miscompiling something.
+namespace ZDrive {
+	static_assert([]() {
+		for (u32 i = 0; i < OPS.size(); i++) if (OPS[i].code != i) return false;
+		return true;
+	}(), "OPS must be indexed by opcode");
+
+	static_assert([]() {
+		for (OpInfo const& op : OPS) if (FindOp(op.name) != &op) return false;
+		return true;
+	}(), "every op must be found by its own name");
+
+	static_assert([]() {
+		for (OpInfo const& op : OPS) {
+			if (op.arity > OpInfo::MAX_OPERANDS) return false;
+			// jumps read where to go and what CLOCK becomes right after each other.
+			if (op.has(OpFlags::JUMPS)) {
+				auto pos = op.operand(OperandKind::POS);
+				if (!pos || pos.value() + 1 >= op.arity || op.operands[pos.value() + 1] != OperandKind::TIME) return false;
+			}
+		}
+		return true;
+	}(), "jumps must take a position followed by a time");
+
+	static_assert(FindOp("jmp") == &OPS[INS::JMP] && FindOp("jmpx") == nullptr && FindOp("") == nullptr);
+}
\ No newline at end of file
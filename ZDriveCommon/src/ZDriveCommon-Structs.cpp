@@ -36,9 +36,13 @@ namespace ZDrive {
 
 #ifdef _DEBUG
 	void Instruction::DebugDisassemble(const u32 offset) const {
-		auto& out = Logger::Log(Logger::LL::Debug) << std::format("{:06d}   {:05d}   {:2d}   {:2d}   {:<12d}   ", offset, header.time, header.diff_mask, header.rank_mask, header.ins);
-		for (Arg const& arg : args)
-			out << std::format("{:12.12s} ", arg.toString());
+		OpInfo const* op = GetOp(header.ins);
+		std::string name = op ? std::string(op->name) : std::to_string(header.ins);
+		auto& out = Logger::Log(Logger::LL::Debug) << std::format("{:06d}   {:05d}   {:2d}   {:2d}   {:<16s} ", offset, header.time, header.diff_mask, header.rank_mask, name);
+		for (u32 i = 0; i < args.size(); i++) {
+			bool isPos = op && i < op->arity && op->operands[i] == OperandKind::POS && args[i].type == AT::CNST;
+			out << std::format("{:12.12s} ", isPos ? "@" + args[i].val.toString(VT::UINT) : args[i].toString());
+		}
 	}
 #endif // _DEBUG
 
@@ -3,14 +3,65 @@
 #include "ZDriveCommon.hpp"
 
 #include <cctype>
+#include <filesystem>
+#include <map>
 
 #include "ZDriveCompiler/Lang.hpp"
+#include "ZDriveCompiler/Options.hpp"
+#include "ZDriveCompiler/Module.hpp"
+#include "ZDriveCompiler/Cache.hpp"
 
 namespace ZDrive::Compiler {
-	/// <summary></summary>
+	/// <summary>Compiles and links one source. Every sub is kept and they get ids in order of declaration, use CompileModule and Link to strip or merge them.</summary>
 	/// <param name="langDecl">The instruction mappings to use.</param>
 	/// <param name="source">The code to compile.</param>
 	/// <param name="entrySubName">The name of the inital sub to be called when the program is run. Defaults to "main".</param>
+	/// <param name="options">Which optional passes to run.</param>
 	/// <returns>The binary compiled code.</returns>
-	std::vector<i32> Compile(LanguageDeclaration const& langDecl, std::string const& source, std::string const& entrySubName = "main");
+	std::vector<i32> Compile(LanguageDeclaration const& langDecl, std::string const& source, std::string const& entrySubName = "main", CompileOptions const& options = {});
+
+	/// <summary>Compiles one source on its own. Binds at the top level are only visible in the same source.</summary>
+	/// <param name="langDecl">The instruction mappings to use.</param>
+	/// <param name="source">The code to compile.</param>
+	/// <param name="name">What to call the module in errors, eg. the source's path.</param>
+	/// <param name="options">Which optional passes to run.</param>
+	/// <returns>The module, or nullopt if there were errors.</returns>
+	std::optional<ObjectModule> CompileModule(LanguageDeclaration const& langDecl, std::string const& source, std::string const& name = "", CompileOptions const& options = {});
+
+	struct ModuleSource {
+		std::string name;
+		std::string source;
+	};
+
+	/// <summary>Compiles each source into its own module, spread across threads. Log output of each is kept together and comes out in the order of sources.</summary>
+	/// <param name="langDecl">The instruction mappings to use. Only read, so sharing it between threads is fine.</param>
+	/// <param name="sources">The sources to compile.</param>
+	/// <param name="options">Which optional passes to run.</param>
+	/// <param name="threads">How many threads to use at most. 0 uses one per core.</param>
+	/// <param name="cache">If given, sources already in it aren't compiled again, and the rest are stored in it.</param>
+	/// <returns>A module for each source, in the same order, or nullopt for the ones that had errors.</returns>
+	std::vector<std::optional<ObjectModule>> CompileModules(LanguageDeclaration const& langDecl, std::vector<ModuleSource> const& sources, CompileOptions const& options = {}, u32 threads = 0, CompileCache* cache = nullptr);
+
+	/// <summary>Links modules into code the VM can run. Subs get ids in order of modules, then in order of declaration,
+	/// and calls go to the first sub declared with the name. Subs that can't be started are left out and identical subs share an id,
+	/// unless options say otherwise or some call goes to an id only known at runtime.</summary>
+	/// <param name="modules">The modules to link.</param>
+	/// <param name="entrySubName">The name of the inital sub to be called when the program is run.</param>
+	/// <param name="options">Which subs may be left out or merged.</param>
+	/// <param name="newIds">If given, filled with the id each sub ended up with, in the order ids would have been given without stripping or merging. -1 for subs that were left out.</param>
+	/// <returns>The binary compiled code, or an empty vector if a call couldn't be resolved.</returns>
+	std::vector<i32> Link(std::span<const ObjectModule> modules, std::string const& entrySubName = "main", LinkOptions const& options = {}, std::vector<u32>* newIds = nullptr);
+
+	/// <summary>Counts how often each sequence of opcodes appears in compiled code, to find candidates for new superinstructions.
+	/// Only sequences that could be fused are counted, ie. ones that run in the same frame with the same masks and aren't jumped into.</summary>
+	/// <param name="code">Code returned by Compile.</param>
+	/// <param name="length">How many instructions long the sequences are.</param>
+	/// <param name="counts">Counts are added to this, so one map can be used for a whole corpus.</param>
+	void MineSequences(std::vector<i32> const& code, u32 length, std::map<std::vector<u32>, u32>& counts);
+
+	/// <summary>Generates C++ that runs the given code natively, one function per sub. Link the result into the host and pass the table to ZVMOptions::nativeSubs.</summary>
+	/// <param name="code">Code returned by Compile.</param>
+	/// <param name="tableName">The name of the generated NativeSub table. Must be a valid C++ identifier.</param>
+	/// <returns>The C++ source, or an empty string if code is malformed.</returns>
+	std::string Transpile(std::vector<i32> const& code, std::string const& tableName = "zdriveNativeSubs");
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+namespace ZDrive::Compiler {
+	// compiled modules on disk, keyed by a hash of everything that goes into compiling one, so unchanged sources aren't compiled again.
+	// not thread safe. CompileModules only uses it from the calling thread.
+	class CompileCache {
+	public:
+		struct Stats {
+			u32 hits = 0;
+			u32 misses = 0;
+			// entries that were there but couldn't be read back. They count as misses too, and get overwritten.
+			u32 corrupt = 0;
+			u32 stored = 0;
+		};
+
+		struct VerifyResult {
+			u32 ok = 0;
+			u32 bad = 0;
+			u32 removed = 0;
+		};
+
+		// the directory is created when the first entry is stored.
+		explicit CompileCache(std::filesystem::path dir) : dir(std::move(dir)) {}
+
+		// bump whenever the compiler's output for the same source, language and options changes, so old entries stop matching.
+		static constexpr u32 COMPILER_VERSION = 4;
+
+		// hashes the source, every instruction in the language, the options and the compiler and module format versions.
+		static u64 Key(LanguageDeclaration const& langDecl, std::string_view source, CompileOptions const& options);
+
+		// the module's name is whatever it was stored with, since the same source can be at more than one path.
+		std::optional<ObjectModule> Load(u64 key);
+		// returns false if the entry couldn't be written. The cache still works, it just misses next time.
+		bool Store(u64 key, ObjectModule const& module);
+
+		// reads back every entry, checking its checksum, that its file name matches its key, and that it deserializes. Logs each bad one.
+		VerifyResult Verify(bool removeBad = false) const;
+
+		inline Stats const& GetStats() const { return stats; }
+		inline std::filesystem::path const& GetDirectory() const { return dir; }
+	private:
+		static constexpr i32 MAGIC = 0x4344425a; // "ZBDC"
+		// [MAGIC, key low, key high, checksum low, checksum high, payload size]
+		static constexpr u32 HEADER_SIZE = 6;
+
+		std::filesystem::path dir;
+		Stats stats;
+
+		std::filesystem::path pathOf(u64 key) const;
+		// returns the module if the entry at path is intact and was stored under key.
+		static std::optional<ObjectModule> read(std::filesystem::path const& path, u64 key);
+	};
+}
\ No newline at end of file
@@ -32,10 +32,16 @@ namespace std {
 }
 
 namespace ZDrive::Compiler {
+	// lets ins_byName be searched with a string_view without building a std::string first.
+	struct TransparentStringHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view str) const { return std::hash<std::string_view>()(str); }
+	};
+
 	class LanguageDeclaration : public LanguageBase<InsDecl> {
 	protected:
 		std::unordered_map<u32, InsDecl> ins_byCode;
-		std::unordered_map<std::string, InsDecl> ins_byName;
+		std::unordered_map<std::string, InsDecl, TransparentStringHash, std::equal_to<>> ins_byName;
 	public:
 		LanguageDeclaration() {}
 		virtual ~LanguageDeclaration() {}
@@ -45,9 +51,14 @@ namespace ZDrive::Compiler {
 		ZResult UndeclareInstruction(u32 code);
 		ZResult UndeclareInstruction(std::string identifier);
 
-		std::optional<InsDecl> get(u32 code) const;
-		std::optional<InsDecl> get(std::string const& name) const;
+		std::optional<std::reference_wrapper<const InsDecl>> get(u32 code) const;
+		// base instructions are found through OpTable's perfect hash, anything declared on top of them falls back to a map lookup.
+		std::optional<std::reference_wrapper<const InsDecl>> get(std::string_view name) const;
+
+		// changes whenever an instruction is declared, undeclared or redefined. Doesn't depend on the order they were declared in.
+		u64 Hash() const;
 
+		// declares every base instruction in OPS the language exposes.
 		void DeclareDefaultBaseIns();
 	};
 	using LangDecl = LanguageDeclaration;
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace ZDrive::Compiler {
+	// one source compiled on its own. Subs don't have their final ids yet, so every sub id a call refers to
+	// is left as a relocation for Link to fill in once it knows about the subs of every module.
+	struct ObjectModule {
+		struct SubDef {
+			std::string name;
+			i32 type = 0;
+			// where the sub's code is in code. Labels are already resolved, since they're offsets within the sub.
+			u32 start = 0;
+			u32 size = 0;
+		};
+
+		// a sub id in some sub's code that refers to a sub by name.
+		struct Relocation {
+			u32 sub; // index into subs of the sub whose code it's in
+			u32 pos; // of the id, from the start of that sub
+			u32 symbol; // index into symbols
+			u32 line; // of the call, for errors
+		};
+
+		// usually the path of the source, used in errors.
+		std::string name;
+		std::vector<SubDef> subs;
+		// every sub's code, back to back in the order of subs.
+		std::vector<i32> code;
+		std::vector<std::string> symbols;
+		std::vector<Relocation> relocations;
+
+		// the module as ints, like compiled code, so it can be written to a file next to it.
+		std::vector<i32> Serialize() const;
+		// returns nullopt if data isn't a serialized module, or one from a different version of the compiler.
+		static std::optional<ObjectModule> Deserialize(std::span<const i32> data);
+
+		static constexpr i32 MAGIC = 0x4f44425a; // "ZBDO"
+		static constexpr i32 VERSION = 2;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+namespace ZDrive::Compiler {
+	// anything added here has to be hashed in CompileCache::Key too.
+	struct CompileOptions {
+		// replace instructions whose inputs are all constants with a SET, and conditional jumps on constants with a JMP or nothing.
+		bool foldConstants = true;
+		// remove instructions that can never run, either because their masks are 0 or because nothing reaches them.
+		bool eliminateDeadCode = true;
+		// make jumps to an unconditional jump go straight to where that one goes.
+		bool threadJumps = true;
+		// remove SETs that are overwritten before anything reads them, and SETs of a variable to itself.
+		bool removeRedundantSets = true;
+		// remove jumps to the instruction right after them.
+		bool layoutBlocks = true;
+		// fuse common instruction sequences into superinstructions (CALL_ARGS, DEC_JMP, CIRCLEPOS_ADD).
+		bool fuseSuperinstructions = true;
+	};
+
+	struct LinkOptions {
+		// leave out subs the entry sub can never start. Turn this off if the host starts subs by id itself.
+		bool stripUnreachableSubs = true;
+		// give subs with the same type and code, calling the same subs, a single id.
+		bool mergeIdenticalSubs = true;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "ZDriveCompiler.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <random>
+
+namespace ZDrive::Compiler {
+	using namespace Logger;
+	namespace fs = std::filesystem;
+
+	namespace {
+		std::optional<std::vector<i32>> readInts(fs::path const& path) {
+			std::error_code ec;
+			usize size = fs::file_size(path, ec);
+			if (ec || size % sizeof(i32) != 0) return std::nullopt;
+			std::ifstream f(path, std::ios::in | std::ios::binary);
+			std::vector<i32> ret(size / sizeof(i32));
+			if (!f.read(reinterpret_cast<char*>(ret.data()), size)) return std::nullopt;
+			return ret;
+		}
+
+		// entries are named after their key, so they can be told apart from anything else in the directory.
+		std::optional<u64> keyOf(fs::path const& path) {
+			std::string stem = path.stem().string();
+			if (path.extension() != ".zo" || stem.size() != 16) return std::nullopt;
+			u64 key = 0;
+			auto [ptr, ec] = std::from_chars(stem.data(), stem.data() + stem.size(), key, 16);
+			if (ec != std::errc() || ptr != stem.data() + stem.size()) return std::nullopt;
+			return key;
+		}
+	}
+
+	u64 CompileCache::Key(LanguageDeclaration const& langDecl, std::string_view source, CompileOptions const& options) {
+		static_assert(sizeof(CompileOptions) == 6, "a CompileOptions field was added or removed, update this");
+		bool flags[] = { options.foldConstants, options.eliminateDeadCode, options.threadJumps,
+			options.removeRedundantSets, options.layoutBlocks, options.fuseSuperinstructions };
+		u64 lang = langDecl.Hash();
+		i32 versions[] = { COMPILER_VERSION, ObjectModule::VERSION };
+
+		// the source's size goes first, so no source can end in a way that looks like the rest.
+		u64 size = source.size();
+		return Hasher().add(&size, sizeof(size)).add(source).add(&lang, sizeof(lang))
+			.add(std::span<const bool>(flags)).add(std::span<const i32>(versions)).get();
+	}
+
+	std::optional<ObjectModule> CompileCache::Load(u64 key) {
+		fs::path path = pathOf(key);
+		if (!fs::exists(path)) {
+			stats.misses++;
+			return std::nullopt;
+		}
+		auto module = read(path, key);
+		if (!module) {
+			Log(LL::Warn) << "Compile cache entry " << path.string() << " is corrupt and will be replaced.";
+			stats.corrupt++;
+			stats.misses++;
+			return std::nullopt;
+		}
+		stats.hits++;
+		return module;
+	}
+
+	bool CompileCache::Store(u64 key, ObjectModule const& module) {
+		std::vector<i32> payload = module.Serialize();
+		u64 checksum = hashCode(payload);
+		std::vector<i32> entry{ MAGIC, static_cast<i32>(key), static_cast<i32>(key >> 32),
+			static_cast<i32>(checksum), static_cast<i32>(checksum >> 32), static_cast<i32>(payload.size()) };
+		entry.insert(entry.end(), payload.begin(), payload.end());
+
+		std::error_code ec;
+		fs::create_directories(dir, ec);
+		// written next to where it goes and then moved there, so nothing ever sees half an entry,
+		// even with other processes using the same directory.
+		fs::path path = pathOf(key);
+		fs::path tmp = path;
+		tmp += std::format(".{:08x}.tmp", std::random_device()());
+		{
+			std::ofstream f(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!f.write(reinterpret_cast<char const*>(entry.data()), entry.size() * sizeof(i32))) {
+				Log(LL::Warn) << "Could not write compile cache entry " << tmp.string() << ".";
+				f.close();
+				fs::remove(tmp, ec);
+				return false;
+			}
+		}
+		fs::rename(tmp, path, ec);
+		if (ec) {
+			Log(LL::Warn) << "Could not write compile cache entry " << path.string() << ": " << ec.message();
+			fs::remove(tmp, ec);
+			return false;
+		}
+		stats.stored++;
+		return true;
+	}
+
+	CompileCache::VerifyResult CompileCache::Verify(bool removeBad) const {
+		VerifyResult result;
+		std::error_code ec;
+		for (fs::directory_entry const& file : fs::directory_iterator(dir, ec)) {
+			if (!file.is_regular_file()) continue;
+			auto key = keyOf(file.path());
+			if (!key) continue;
+			if (read(file.path(), key.value())) {
+				result.ok++;
+				continue;
+			}
+
+			result.bad++;
+			Log(LL::Warn) << "Compile cache entry " << file.path().string() << " is corrupt.";
+			std::error_code removeEc;
+			if (removeBad && fs::remove(file.path(), removeEc)) result.removed++;
+		}
+		if (ec) Log(LL::Error) << "Could not read compile cache directory " << dir.string() << ": " << ec.message();
+		return result;
+	}
+
+	fs::path CompileCache::pathOf(u64 key) const {
+		return dir / std::format("{:016x}.zo", key);
+	}
+
+	std::optional<ObjectModule> CompileCache::read(fs::path const& path, u64 key) {
+		auto entry = readInts(path);
+		if (!entry || entry->size() < HEADER_SIZE) return std::nullopt;
+		std::vector<i32> const& e = entry.value();
+		u64 storedKey = static_cast<u32>(e[1]) | (static_cast<u64>(static_cast<u32>(e[2])) << 32);
+		u64 checksum = static_cast<u32>(e[3]) | (static_cast<u64>(static_cast<u32>(e[4])) << 32);
+		if (e[0] != MAGIC || storedKey != key || e[5] < 0 || static_cast<usize>(e[5]) != e.size() - HEADER_SIZE) return std::nullopt;
+
+		std::span<const i32> payload(e.begin() + HEADER_SIZE, e.end());
+		if (hashCode(payload) != checksum) return std::nullopt;
+		return ObjectModule::Deserialize(payload);
+	}
+}
\ No newline at end of file
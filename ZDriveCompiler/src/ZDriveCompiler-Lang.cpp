@@ -1,5 +1,7 @@
 #include "ZDriveCompiler.hpp"
 
+#include <algorithm>
+
 namespace ZDrive::Compiler {
 
 	ZResult LanguageDeclaration::DeclareInstruction(InsDecl const& decl) {
@@ -56,84 +58,41 @@ namespace ZDrive::Compiler {
 		return { true, msgs };
 	}
 
-	std::optional<InsDecl> LanguageDeclaration::get(u32 code) const {
+	std::optional<std::reference_wrapper<const InsDecl>> LanguageDeclaration::get(u32 code) const {
 		if (auto res = ins_byCode.find(code); res != ins_byCode.end())
-			return { res->second };
+			return std::cref(res->second);
 		return std::nullopt;
 	}
 
-	std::optional<InsDecl> LanguageDeclaration::get(std::string const& name) const {
+	std::optional<std::reference_wrapper<const InsDecl>> LanguageDeclaration::get(std::string_view name) const {
+		// the op's code may have been undeclared or given to something else, so it only counts if the name still matches.
+		if (OpInfo const* op = FindOp(name)) {
+			if (auto res = ins_byCode.find(op->code); res != ins_byCode.end() && res->second.identifier == name)
+				return std::cref(res->second);
+		}
 		if (auto res = ins_byName.find(name); res != ins_byName.end())
-			return { res->second };
+			return std::cref(res->second);
 		return std::nullopt;
 	}
 
-	void LanguageDeclaration::DeclareDefaultBaseIns() {
-#define di(code, argc, name) DeclareInstruction(InsDecl(static_cast<u32>(code), argc, name))
+	u64 LanguageDeclaration::Hash() const {
+		std::vector<InsDecl const*> sorted;
+		sorted.reserve(ins_byCode.size());
+		for (auto const& [code, decl] : ins_byCode) sorted.push_back(&decl);
+		std::sort(sorted.begin(), sorted.end(), [](InsDecl const* a, InsDecl const* b) { return a->code < b->code; });
 
-		di(INS::NOP, 0, "nop");
-		di(INS::RET, 0, "ret");
-		di(INS::WAIT, 1, "wait");
-		di(INS::JMP, 2, "jmp");
-		di(INS::LOOP, 3, "loop");
-		di(INS::SET, 2, "set");
-		di(INS::ISET, 2, "iset");
-		di(INS::FSET, 2, "fset");
-		di(INS::ISET_RAND_SIGN, 2, "iset_rand_sign");
-		di(INS::FSET_RAND_SIGN, 2, "fset_rand_sign");
-		di(INS::IADD, 2, "iadd");
-		di(INS::ISUB, 2, "isub");
-		di(INS::IMUL, 2, "imul");
-		di(INS::IDIV, 2, "idiv");
-		di(INS::IMOD, 2, "imod");
-		di(INS::IMOD2, 2, "imod2");
-		di(INS::FADD, 2, "fadd");
-		di(INS::FSUB, 2, "fsub");
-		di(INS::FMUL, 2, "fmul");
-		di(INS::FDIV, 2, "fdiv");
-		di(INS::FMOD, 2, "fmod");
-		di(INS::FMOD2, 2, "fmod2");
-		di(INS::ISET_ADD, 3, "iset_add");
-		di(INS::ISET_SUB, 3, "iset_sub");
-		di(INS::ISET_MUL, 3, "iset_mul");
-		di(INS::ISET_DIV, 3, "iset_div");
-		di(INS::ISET_MOD, 3, "iset_mod");
-		di(INS::FSET_ADD, 3, "fset_add");
-		di(INS::FSET_SUB, 3, "fset_sub");
-		di(INS::FSET_MUL, 3, "fset_mul");
-		di(INS::FSET_DIV, 3, "fset_div");
-		di(INS::FSET_MOD, 3, "fset_mod");
-		di(INS::IINC, 1, "iinc");
-		di(INS::FINC, 1, "finc");
-		di(INS::IDEC, 1, "idec");
-		di(INS::FDEC, 1, "fdec");
-		di(INS::FSET_SIN, 2, "fset_sin");
-		di(INS::FSET_COS, 2, "fset_cos");
-		di(INS::FSET_TAN, 2, "fset_tan");
-		di(INS::FSET_ANGLE, 5, "fset_angle");
-		di(INS::FINTERP, 7, "finterp");
-		di(INS::NORMRAD, 1, "normRad");
-		di(INS::MATHCIRCLEPOS, 4, "mathCirclePos");
-		di(INS::MATHDISTANCE, 5, "mathDistance");
-		di(INS::JMP_EQU, 4, "jmp_equ");
-		di(INS::JMP_EQU_F, 5, "jmp_equ_f");
-		di(INS::JMP_NEQ, 4, "jmp_neq");
-		di(INS::JMP_NEQ_F, 5, "jmp_neq_f");
-		di(INS::JMP_LT, 4, "jmp_lt");
-		di(INS::JMP_LT_F, 4, "jmp_lt_f");
-		di(INS::JMP_LTE, 4, "jmp_lte");
-		di(INS::JMP_LTE_F, 5, "jmp_lte_f");
-		di(INS::JMP_GT, 4, "jmp_gt");
-		di(INS::JMP_GT_F, 4, "jmp_gt_f");
-		di(INS::JMP_GTE, 4, "jmp_gte");
-		di(INS::JMP_GTE_F, 5, "jmp_gte_f");
-		di(INS::CALL, 1, "call");
-		di(INS::YEILD, 0, "yeild");
-		di(INS::PRINT, 3, "print");
-		di(INS::SET_PTR, 2, "set_ptr");
-		di(INS::ASSERT_PTR, 2, "assert_ptr");
-		di(INS::SET_PRIORITY, 1, "set_priority");
+		Hasher hasher;
+		for (InsDecl const* decl : sorted) {
+			u32 header[] = { decl->code, decl->argcount, static_cast<u32>(decl->identifier.size()) };
+			hasher.add(std::span<const u32>(header)).add(decl->identifier);
+		}
+		return hasher.get();
+	}
 
-#undef di
+	void LanguageDeclaration::DeclareDefaultBaseIns() {
+		for (OpInfo const& op : OPS) {
+			if (op.has(OpFlags::INTERNAL)) continue;
+			DeclareInstruction(InsDecl(op.code, op.arity, std::string(op.name)));
+		}
 	}
 }
\ No newline at end of file
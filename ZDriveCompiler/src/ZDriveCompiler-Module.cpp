@@ -0,0 +1,103 @@
+#include "ZDriveCompiler.hpp"
+
+namespace ZDrive::Compiler {
+	namespace {
+		// strings are their length in bytes followed by the bytes, padded to a whole number of ints.
+		void writeString(std::vector<i32>& out, std::string const& str) {
+			out.push_back(static_cast<i32>(str.size()));
+			usize start = out.size();
+			out.resize(start + (str.size() + sizeof(i32) - 1) / sizeof(i32), 0);
+			if (!str.empty()) memcpy(out.data() + start, str.data(), str.size());
+		}
+
+		// reads from the front of data, which is advanced past whatever was read. All return false if data is too short.
+		bool readInt(std::span<const i32>& data, i32& out) {
+			if (data.empty()) return false;
+			out = data[0];
+			data = data.subspan(1);
+			return true;
+		}
+
+		bool readCount(std::span<const i32>& data, u32& out) {
+			i32 val;
+			// anything bigger than what's left can't be right, and checking here keeps reserve from blowing up on bad data.
+			if (!readInt(data, val) || val < 0 || static_cast<usize>(val) > data.size()) return false;
+			out = static_cast<u32>(val);
+			return true;
+		}
+
+		bool readString(std::span<const i32>& data, std::string& out) {
+			i32 size;
+			if (!readInt(data, size) || size < 0) return false;
+			usize words = (static_cast<usize>(size) + sizeof(i32) - 1) / sizeof(i32);
+			if (words > data.size()) return false;
+			out.assign(reinterpret_cast<char const*>(data.data()), size);
+			data = data.subspan(words);
+			return true;
+		}
+	}
+
+	std::vector<i32> ObjectModule::Serialize() const {
+		std::vector<i32> out{ MAGIC, VERSION };
+		writeString(out, name);
+
+		out.push_back(static_cast<i32>(subs.size()));
+		for (SubDef const& sub : subs) {
+			writeString(out, sub.name);
+			out.insert(out.end(), { sub.type, static_cast<i32>(sub.start), static_cast<i32>(sub.size) });
+		}
+
+		out.push_back(static_cast<i32>(code.size()));
+		out.insert(out.end(), code.begin(), code.end());
+
+		out.push_back(static_cast<i32>(symbols.size()));
+		for (std::string const& symbol : symbols) writeString(out, symbol);
+
+		out.push_back(static_cast<i32>(relocations.size()));
+		for (Relocation const& reloc : relocations) {
+			out.insert(out.end(), { static_cast<i32>(reloc.sub), static_cast<i32>(reloc.pos), static_cast<i32>(reloc.symbol), static_cast<i32>(reloc.line) });
+		}
+		return out;
+	}
+
+	std::optional<ObjectModule> ObjectModule::Deserialize(std::span<const i32> data) {
+		ObjectModule ret;
+		i32 magic, version;
+		if (!readInt(data, magic) || magic != MAGIC || !readInt(data, version) || version != VERSION) return std::nullopt;
+		if (!readString(data, ret.name)) return std::nullopt;
+
+		u32 count;
+		if (!readCount(data, count)) return std::nullopt;
+		ret.subs.resize(count);
+		for (SubDef& sub : ret.subs) {
+			i32 start, size;
+			if (!readString(data, sub.name) || !readInt(data, sub.type) || !readInt(data, start) || !readInt(data, size)) return std::nullopt;
+			if (start < 0 || size < 0) return std::nullopt;
+			sub.start = static_cast<u32>(start);
+			sub.size = static_cast<u32>(size);
+		}
+
+		if (!readCount(data, count)) return std::nullopt;
+		ret.code.assign(data.begin(), data.begin() + count);
+		data = data.subspan(count);
+		for (SubDef const& sub : ret.subs) {
+			if (static_cast<usize>(sub.start) + sub.size > ret.code.size()) return std::nullopt;
+		}
+
+		if (!readCount(data, count)) return std::nullopt;
+		ret.symbols.resize(count);
+		for (std::string& symbol : ret.symbols) if (!readString(data, symbol)) return std::nullopt;
+
+		if (!readCount(data, count) || static_cast<usize>(count) * 4 > data.size()) return std::nullopt;
+		ret.relocations.resize(count);
+		for (Relocation& reloc : ret.relocations) {
+			reloc = { static_cast<u32>(data[0]), static_cast<u32>(data[1]), static_cast<u32>(data[2]), static_cast<u32>(data[3]) };
+			data = data.subspan(4);
+			// the linker trusts these, so they have to point at something.
+			if (reloc.sub >= ret.subs.size() || reloc.pos >= ret.subs[reloc.sub].size || reloc.symbol >= ret.symbols.size()) return std::nullopt;
+		}
+
+		if (!data.empty()) return std::nullopt;
+		return ret;
+	}
+}
\ No newline at end of file
@@ -2,8 +2,67 @@
 
 #include "compiler.hpp"
 
+#include <atomic>
+#include <sstream>
+#include <thread>
+
 namespace ZDrive::Compiler {
-	std::vector<i32> Compile(LanguageDeclaration const& langDecl, std::string const& source, std::string const& entrySubName) {
-		return _Compiler(langDecl, source, entrySubName)();
+	std::vector<i32> Compile(LanguageDeclaration const& langDecl, std::string const& source, std::string const& entrySubName, CompileOptions const& options) {
+		auto module = CompileModule(langDecl, source, "", options);
+		if (!module) return {};
+		// the host may start any sub by id, so they all keep the ids they were declared with.
+		return Link(std::span(&module.value(), 1), entrySubName, { .stripUnreachableSubs = false, .mergeIdenticalSubs = false });
+	}
+
+	std::optional<ObjectModule> CompileModule(LanguageDeclaration const& langDecl, std::string const& source, std::string const& name, CompileOptions const& options) {
+		return _Compiler(langDecl, source, name, options)();
+	}
+
+	std::vector<std::optional<ObjectModule>> CompileModules(LanguageDeclaration const& langDecl, std::vector<ModuleSource> const& sources, CompileOptions const& options, u32 threads, CompileCache* cache) {
+		std::vector<std::optional<ObjectModule>> modules(sources.size());
+		// indices of the sources that actually need compiling.
+		std::vector<usize> todo;
+		std::vector<u64> keys(cache ? sources.size() : 0);
+		for (usize i = 0; i < sources.size(); i++) {
+			if (cache) {
+				keys[i] = CompileCache::Key(langDecl, sources[i].source, options);
+				if ((modules[i] = cache->Load(keys[i]))) {
+					modules[i]->name = sources[i].name;
+					continue;
+				}
+			}
+			todo.push_back(i);
+		}
+
+		if (threads == 0) threads = max(std::thread::hardware_concurrency(), 1u);
+		threads = min(threads, static_cast<u32>(todo.size()));
+
+		if (threads <= 1) {
+			for (usize i : todo) modules[i] = CompileModule(langDecl, sources[i].source, sources[i].name, options);
+		} else {
+			// each module's log is held back and written out in order afterwards, so output doesn't depend on which thread got there first.
+			std::vector<std::ostringstream> logs(todo.size());
+			std::atomic<usize> next = 0;
+			auto work = [&]() {
+				for (usize t; (t = next++) < todo.size(); ) {
+					Logger::SetThreadOutput(&logs[t]);
+					usize i = todo[t];
+					modules[i] = CompileModule(langDecl, sources[i].source, sources[i].name, options);
+				}
+				Logger::SetThreadOutput(nullptr);
+			};
+
+			std::vector<std::thread> workers;
+			workers.reserve(threads);
+			for (u32 i = 0; i < threads; i++) workers.emplace_back(work);
+			for (std::thread& worker : workers) worker.join();
+
+			for (std::ostringstream const& log : logs) Logger::Write(log.str());
+		}
+
+		if (cache) {
+			for (usize i : todo) if (modules[i]) cache->Store(keys[i], modules[i].value());
+		}
+		return modules;
 	}
 }
\ No newline at end of file
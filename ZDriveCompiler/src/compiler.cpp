@@ -2,6 +2,9 @@
 
 #include "compiler.hpp"
 
+#include <algorithm>
+#include <charconv>
+
 #include "core.hpp"
 
 
@@ -22,75 +25,64 @@ Sub& subVarName = currentSub().value();
 namespace ZDrive::Compiler {
 	using namespace Logger;
 
-	_Compiler::_Compiler(LanguageDeclaration const& langDecl, std::string const& source, std::string const& entrySubName) :
-		lang(langDecl), src(source), entryName(entrySubName),
-		hadError(false), panicMode(false), scanner(source) {}
+	_Compiler::_Compiler(LanguageDeclaration const& langDecl, std::string const& source, std::string const& moduleName, CompileOptions const& options) :
+		lang(langDecl), src(source), moduleName(moduleName), options(options), symbols(names, langDecl),
+		hadError(false), panicMode(false), scanner(source, names) {}
 
-	std::vector<i32> _Compiler::operator()() {
+	std::optional<ObjectModule> _Compiler::operator()() {
+		// unoptimized code comes out at about an int per 1.5-2 bytes of source, so most compiles never grow the arena.
+		arena.reserve(src.size() * 2 / 3);
 		advance();
 
 		while (!check(TOKEN::EOS)) {
 			topLevel();
 		}
 
-		if (hadError) return {};
-
-		const u32 headerSize = subs.size() * 3 + 2;
-		u32 codeSize = headerSize;
+		if (hadError) return std::nullopt;
 
+		OptimizationStats stats;
+		// subs only ever shrink, so each one is moved down over whatever the ones before it gave up, leaving no gaps.
+		u32 writePos = 0;
 		for (Sub& sub : subs) {
-			codeSize += sub.code.size();
-			
-			// for each label referenced
-			for (auto& pair1 : sub.labelRefs) {
-				std::vector<std::pair<u32, u32>>& refs = pair1.second; // list of references to that label
-
-				// find that label in the map of valid labels to their locations
-				auto offset_it = sub.labels.find(pair1.first);
-				// if its not found
-				if (offset_it == sub.labels.end()) {
-					// for each reference to it, print an error
-					for (auto& pair2 : refs)
-						Log(LL::Fatal) << "Label \"" << pair1.first << "\" (line " << pair2.second << ") not found.";
-					// compilation failed
-					return {};
-				}
-
-				// if it is found, get its value
-				u32 offset = offset_it->second;
-				// for each one, modify the arg 
-				for (auto& pair2 : refs) {
-					sub.code[pair2.first] = AT::CNST;
-					sub.code[pair2.first+1] = offset;
-				}
-			}
+			if (!allocateTemps(sub) || !resolveLabels(sub)) return std::nullopt;
+			optimize(sub, writePos, options, stats);
+			writePos += sub.size();
 		}
+		arena.resize(writePos);
 
-		u32 entryFuncId = static_cast<u32>(-1);
-		auto entrySub_opt = findSub(entryName);
-		if (!entrySub_opt) {
-			Log(LL::Warn) << "Entry sub '" << entryName << " was not found. Code will compile but will not run.";
-		} else {
-			entryFuncId = entrySub_opt.value().get().id;
+		Log(LL::Debug) << "Folded " << stats.folded << ", removed " << stats.maskedOut << " masked out, " << stats.unreachable << " unreachable, "
+			<< stats.redundantSets << " redundant sets and " << stats.jumpsToNext << " jumps to next, threaded " << stats.threaded << " jumps.";
+		if (options.fuseSuperinstructions) {
+			Log(LL::Debug) << "Fused " << stats.fusion.callArgs << " call_args, " << stats.fusion.decJmp << " dec_jmp, " << stats.fusion.circlePosAdd 
+				<< " circlepos_add (" << stats.fusion.removed << " instructions removed).";
 		}
+		if (stats.skippedSubs) Log(LL::Debug) << stats.skippedSubs << " subs were not optimized because they jump to computed positions.";
 
-		std::vector<i32> code;
-		
-		code.reserve(codeSize);
-		code.resize(headerSize);
-		u32 writePos = subs.size() * 3 + 2;
-		code[0] = subs.size();
-		code[1] = entryFuncId;
+		ObjectModule module;
+		module.name = moduleName;
+		module.subs.reserve(subs.size());
+		// symbolIndex[sym] is the index of sym in module.symbols, if it's been added.
+		std::unordered_map<u32, u32> symbolIndex;
 		for (u32 i = 0; i < subs.size(); i++) {
 			Sub& sub = subs[i];
-			code[i*3+2] = 0;
-			code[i*3+3] = sub.code.size();
-			code[i*3+4] = writePos;
-			writeAll(code, sub.code);
-			writePos += sub.code.size();
+			// the optimizer moves calls around, so the relocations are only collected now.
+			for (u32 offset = 0; offset + INS_HEADER_SIZE <= sub.size(); ) {
+				u32 argc = sub.at(offset + INS_ARGCOUNT);
+				for (u32 arg = offset + INS_HEADER_SIZE; arg < offset + INS_HEADER_SIZE + argc * 2; arg += 2) {
+					if (sub.at(arg) != AT::TEMP_SUB) continue;
+					auto [sym, line] = subRefs[sub.at(arg + 1)];
+					auto [index, added] = symbolIndex.try_emplace(sym, static_cast<u32>(module.symbols.size()));
+					if (added) module.symbols.emplace_back(names.name(sym));
+					module.relocations.push_back({ i, arg + 1, index->second, line });
+					sub.at(arg) = AT::CNST;
+					sub.at(arg + 1) = 0;
+				}
+				offset += INS_HEADER_SIZE + argc * 2;
+			}
+			module.subs.push_back({ std::move(sub.name), sub.type, sub.start, sub.size() });
 		}
-
-		return code;
+		module.code = std::move(arena);
+		return module;
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -104,8 +96,25 @@ namespace ZDrive::Compiler {
 		return ret;
 	}
 
+	i64 _Compiler::readInt(std::string_view str) {
+		if (str.starts_with('+')) str.remove_prefix(1);
+		i64 val = 0;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), val);
+		// saturate like strtoll does.
+		if (ec == std::errc::result_out_of_range) return str.starts_with('-') ? INT64_MIN : INT64_MAX;
+		return val;
+	}
+
+	f32 _Compiler::readFloat(std::string_view str) {
+		f32 val = 0.0f;
+		auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), val);
+		// strtof rounds to inf or 0 instead, and this is rare enough that copying for it is fine.
+		if (ec == std::errc::result_out_of_range) return strtof(std::string(str).c_str(), nullptr);
+		return val;
+	}
+
 	Value _Compiler::readIntToken(Token const& token) {
-		i64 val = strtoll(token.str.c_str(), nullptr, 10);
+		i64 val = readInt(token.str);
 		if (val <= INT32_MAX && val >= INT32_MIN) {
 			// i forgot that return types can be implicitly converted
 			return static_cast<i32>(val);
@@ -117,25 +126,37 @@ namespace ZDrive::Compiler {
 
 	std::optional<u32> _Compiler::extractId(Token const& token) {
 		if (token.type == TOKEN::VTID) {
-			if (std::isalpha(token.str[1])) {
-				Token t{ TOKEN::IDENTIFIER, token.str.substr(1), token.line };
+			if (Scanner::isalpha(token.str[1])) {
+				Token t{ TOKEN::IDENTIFIER, token.str.substr(1), token.line, token.sym };
 				resolveBinding(t);
 				if (t.type == TOKEN::IDENTIFIER) {
 					errorAtCurrent("Unknown identifier");
 					return std::nullopt;
 				}
-				if (t.type == TOKEN::INT) return strtoul(t.str.c_str(), nullptr, 10);
-			} else if (std::isdigit(token.str[1])) return strtoul(token.str.c_str()+1, nullptr, 10);
+				if (t.type == TOKEN::INT) return static_cast<u32>(readInt(t.str));
+			} else if (Scanner::isdigit(token.str[1])) return static_cast<u32>(readInt(token.str.substr(1)));
 		}
 		errorAtCurrent("Invalid VTID");
 		return std::nullopt;
 	}
 
-	std::optional<std::reference_wrapper<Sub>> _Compiler::findSub(std::string name) {
-		for (Sub& sub : subs) {
-			if (sub.name == name) return { sub };
-		} 
-		return std::nullopt;
+	bool _Compiler::resolveLabels(Sub& sub) {
+		if (sub.labelRefs.empty()) return true;
+		// stable, so the last declaration of a label comes last among ones with the same name.
+		std::stable_sort(sub.labels.begin(), sub.labels.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+		bool ok = true;
+		for (LabelRef const& ref : sub.labelRefs) {
+			auto it = std::upper_bound(sub.labels.begin(), sub.labels.end(), ref.sym, [](u32 sym, auto const& label) { return sym < label.first; });
+			if (it == sub.labels.begin() || (--it)->first != ref.sym) {
+				Log(LL::Fatal) << "Label \"" << names.name(ref.sym) << "\" (line " << ref.line << ") not found.";
+				ok = false;
+				continue;
+			}
+			sub.at(ref.pos) = AT::CNST;
+			sub.at(ref.pos + 1) = it->second;
+		}
+		return ok;
 	}
 
 	////////////////////////////////////////////////////
@@ -144,7 +165,7 @@ namespace ZDrive::Compiler {
 		if (panicMode) return;
 		panicMode = true;
 		hadError = true;
-		Log(LL::Error) << "[line " << token.line << "] Error at " << (token.type == TOKEN::EOS ? "end" : (std::string("'") + token.str + "'").c_str()) << ": " << message.c_str();
+		Log(LL::Error) << "[line " << token.line << "] Error at " << (token.type == TOKEN::EOS ? "end" : std::format("'{}'", token.str).c_str()) << ": " << message.c_str();
 	}
 
 	//void _Compiler::errorAtPrevious(std::string message) { errorAt(previous, message); }
@@ -156,25 +177,9 @@ namespace ZDrive::Compiler {
 		bool ret = false;
 		bool result = true;
 		while (token.type == TOKEN::IDENTIFIER && result) {
-
-			// frick this entire body
-			// in C when I could do things how i wanted, all of this was just
-			// key = createTableKey(token->start, token->length);
-			// result = ((info) ? tableGet(&info->bindings, key, &val) : false) || tableGet(&compiler->bindings, key, &val);
-			// to me thats easier to read
-			// to be fair though... i did spend another 18 lines after that just turning a string into a number
-
-			// what this does:
-			// the current sub may or may not exist depending on whether the compiler is in the global scope.
-			// therefor, currentSub() returns an optional reference to a sub.
-			// the lambda in .and_then takes the optional sub reference. It checks if the bindings in that sub contains a mapping from the passed in token to some other one.
-			// Return an optional based on whether a binding was found. If it does, the optional is a reference to the value token, otherwise null.
-			// If that returned nullopt (.or_else), then do the same for the global scope, otherwise .or_else just forwards the optional if it has a value (which would be the sub-scope binding)
-			std::optional<std::reference_wrapper<Token>> val = currentSub()
-				.and_then([&token](auto in) {auto val = in.get().bindings.find(token.str); return val == in.get().bindings.end() ? std::nullopt : std::optional<std::reference_wrapper<Token>>(val->second); })
-				.or_else([&token, this]() {auto val = bindings.find(token.str); return val == bindings.end() ? std::nullopt : std::optional<std::reference_wrapper<Token>>(val->second); });
-			// finally, if a binding was found, replace the current token we're trying to resolve with its bound value.
-			// also, store whether it found a value so resolveBinding can return whether or not it was successful in resolving the binding.
+			// bindings made in the current sub already shadow global ones in the table, so this is the only lookup.
+			std::optional<Token> const& val = symbols.binding(token.sym);
+			// if a binding was found, replace the token we're trying to resolve with its bound value and keep going, since that might be bound too.
 			if ((result = val.has_value()) == true) {
 				token = val.value();
 				token.line = line;
@@ -198,7 +203,7 @@ namespace ZDrive::Compiler {
 			if (current.type == TOKEN::IDENTIFIER) resolveBinding(current);
 			if (current.type != TOKEN::ERR) break;
 
-			errorAtCurrent(current.str);
+			errorAtCurrent(std::string(current.str));
 		}
 	}
 
@@ -221,6 +226,7 @@ namespace ZDrive::Compiler {
 			case TOKEN::SUB:
 			case TOKEN::LOOP:
 			case TOKEN::WHILE:
+			case TOKEN::UNTIL:
 			case TOKEN::BIND:
 				return;
 			default:;
@@ -254,17 +260,11 @@ namespace ZDrive::Compiler {
 	void _Compiler::bindDecl() {
 		advance();
 		consume(TOKEN::IDENTIFIER, "Expected identifier: binding key");
-		std::string key = previous.str;
+		u32 key = previous.sym;
 		advance();
 
-		auto sub_opt = currentSub();
-		if (sub_opt) {
-			sub_opt.value().get().bindings[key] = previous;
-		} else {
-			bindings[key] = previous;
-		}
-		// frick this optionals monad functor bs
-		//currentSub().transform([](auto in) {return in.get().bindings; }).value_or(bindings)[key] = previous;
+		// scoped to the current sub, if there is one.
+		symbols.bind(key, previous);
 
 		consume(TOKEN::SEMICOLON, "Expected semicolon");
 	}
@@ -276,13 +276,19 @@ namespace ZDrive::Compiler {
 		Sub sub;
 		sub.name = previous.str;
 		sub.id = subs.size();
+		sub.arena = &arena;
+		sub.start = static_cast<u32>(arena.size());
+		if (!symbols.declareSub(previous.sym, sub.id))
+			Log(LL::Warn) << "[line " << previous.line << "] Sub '" << sub.name << "' was already declared. Calls will go to the first one.";
+		// the args and any binds in the body only last until the end of the sub.
+		symbols.pushScope();
 		consume(TOKEN::LPR, "Expected left parenthesis");
 
 		u32 i = VTID::IN0 - 1;
 		while (i <= VTID::IN7) {
 			if (match(TOKEN::IDENTIFIER)) {
 				i++;
-				sub.bindings[previous.str] = Token{ TOKEN::INT, std::to_string(i), previous.line };
+				symbols.bind(previous.sym, Token{ TOKEN::INT, names.name(names.intern(std::to_string(i))), previous.line });
 			}
 			if (match(TOKEN::COMMA)) continue;
 			consume(TOKEN::RPR, "Expected right parenthesis");
@@ -294,6 +300,7 @@ namespace ZDrive::Compiler {
 		consume(TOKEN::LBR, "Expected left bracket");
 		subLevel();
 		consume(TOKEN::RBR, "Expected right bracket");
+		symbols.popScope();
 
 		// this shouldnt really be necessary but oh well.
 		if (subs.back().nestLevel != -1) {
@@ -313,12 +320,11 @@ namespace ZDrive::Compiler {
 		while (!check(TOKEN::RBR) && !check(TOKEN::EOS)) {
 			switch (current.type) {
 			case TOKEN::IDENTIFIER: {
-				if (auto res = lang.get(current.str); res.has_value()) {
-					funcCall(res.value());
-				} else if (auto toCall = findSub(current.str); toCall) { // skull emoji (inline function that checks if subs contains one with the name current.str and makes it available)
-					subCall(toCall.value().get());
+				// instructions take priority over subs with the same name. Anything else is a sub that might be declared later.
+				if (auto const& ins = symbols.ins(current.sym); ins.has_value()) {
+					funcCall(ins.value());
 				} else {
-					errorAtCurrent("Unexpected token: identifier");
+					subCall(current.sym);
 				}
 				break;
 			}
@@ -332,7 +338,12 @@ namespace ZDrive::Compiler {
 			case TOKEN::LOOP: loopStatement(); break;
 			case TOKEN::WHILE:
 			case TOKEN::WHILE_F: whileStatement(); break;
+			case TOKEN::UNTIL:
+			case TOKEN::UNTIL_F: untilStatement(); break;
 			case TOKEN::BIND: bindDecl(); break;
+			// a name bound to a var id, or a $ref to a var holding one.
+			case TOKEN::INT:
+			case TOKEN::VTID: assignment(); break;
 			default:
 				errorAtCurrent("Unexpected token");
 				advance();
@@ -351,17 +362,27 @@ namespace ZDrive::Compiler {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
 		InsHead head{sub.time, sub.diff, sub.rank, func.code, func.argcount};
-		writeInsHead(sub.code, head);
+		sub.writeInsHead(head);
 
 		advance();
 
+		OpInfo const* op = GetOp(func.code);
 		u32 argsWritten = 0;
 		consume(TOKEN::LPR, "Expected left parenthesis");
 		while (!check(TOKEN::RPR)) {
 			Token arg_token = current;
+			// subs can be passed by name where an id is expected, eg. emit_ring(bullet, ...). They're relocated like calls.
+			if (check(TOKEN::IDENTIFIER) && op && argsWritten < op->arity && op->operands[argsWritten] == OperandKind::SUB) {
+				sub.writeArg({ AT::TEMP_SUB, static_cast<u32>(subRefs.size()) });
+				subRefs.emplace_back(current.sym, current.line);
+				advance();
+				argsWritten++;
+				if (match(TOKEN::COMMA)) continue;
+				break;
+			}
 			Arg arg = argument();
 			if (arg.type == AT::TEMP_LABEL) {
-				sub.labelRefs[arg_token.str].emplace_back(sub.code.size(), arg_token.line);
+				sub.labelRefs.push_back({ arg_token.sym, sub.size(), arg_token.line });
 			}
 			sub.writeArg(arg);
 			argsWritten++;
@@ -376,10 +397,11 @@ namespace ZDrive::Compiler {
 		consume(TOKEN::SEMICOLON, "Expected semicolon");
 	}
 
-	void _Compiler::subCall(Sub const& other) {
+	void _Compiler::subCall(u32 sym) {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
-		Ins callIns{ {sub.time, sub.diff, sub.rank, INS::CALL, 1}, {{AT::CNST, other.id}} };
+		Ins callIns{ {sub.time, sub.diff, sub.rank, INS::CALL, 1}, {{AT::TEMP_SUB, static_cast<u32>(subRefs.size())}} };
+		subRefs.emplace_back(sym, current.line);
 
 		advance();
 		consume(TOKEN::LPR, "Expected left parenthesis");
@@ -394,7 +416,7 @@ namespace ZDrive::Compiler {
 				{{AT::CNST, i}, arg}
 			));
 			if (arg.type == AT::TEMP_LABEL) {
-				sub.labelRefs[arg_token.str].emplace_back(sub.code.size()-2, arg_token.line);
+				sub.labelRefs.push_back({ arg_token.sym, sub.size() - 2, arg_token.line });
 			}
 
 			if (match(TOKEN::COMMA)) continue;
@@ -421,7 +443,7 @@ namespace ZDrive::Compiler {
 			return Arg{ AT::VTREF, id.value() };
 		}
 		case TOKEN::FLOAT: 
-			return Arg{ AT::CNST, strtof(previous.str.c_str(), nullptr) };
+			return Arg{ AT::CNST, readFloat(previous.str) };
 		case TOKEN::INT:
 			return Arg{ AT::CNST, readIntToken(previous) };
 		}
@@ -445,7 +467,7 @@ namespace ZDrive::Compiler {
 			return {{AT::VTREF, id.value()}};
 		}
 		case TOKEN::FLOAT:
-			return {{AT::CNST, {strtof(previous.str.c_str(), nullptr)}}};
+			return {{AT::CNST, {readFloat(previous.str)}}};
 		case TOKEN::INT:
 			return {{AT::CNST, readIntToken(previous)}};
 		}
@@ -457,7 +479,7 @@ namespace ZDrive::Compiler {
 	void _Compiler::label() {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
-		sub.labels[current.str.substr(1)] = sub.code.size();
+		sub.labels.emplace_back(current.sym, sub.size());
 		advance();
 		consume(TOKEN::COLON, "Expected colon");
 	}
@@ -465,11 +487,11 @@ namespace ZDrive::Compiler {
 	void _Compiler::timestamp() {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 		
-		i32 time = strtol(current.str.c_str() + 1, nullptr, 10);
+		i32 time = static_cast<i32>(readInt(current.str.substr(1)));
 		char c = current.str[1];
 		if (c == '+' || c == '-') {
 			sub.time += time;
-		} else if (std::isdigit(c)) {
+		} else if (Scanner::isdigit(c)) {
 			sub.time = time;
 		} else {
 			errorAtCurrent("Invalid timestamp");
@@ -481,7 +503,7 @@ namespace ZDrive::Compiler {
 	void _Compiler::diffspec() {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
-		sub.diff = strtoul(current.str.c_str() + 1, nullptr, 10);
+		sub.diff = static_cast<u32>(readInt(current.str.substr(1)));
 		advance();
 		consume(TOKEN::COLON, "Expected colon");
 	}
@@ -489,7 +511,7 @@ namespace ZDrive::Compiler {
 	void _Compiler::rankspec() {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
-		sub.rank = strtoul(current.str.c_str() + 1, nullptr, 10);
+		sub.rank = static_cast<u32>(readInt(current.str.substr(1)));
 		advance();
 		consume(TOKEN::COLON, "Expected colon");
 	}
@@ -499,45 +521,11 @@ namespace ZDrive::Compiler {
 
 		bool is_f = current.type == TOKEN::IF_F;
 		advance();
-		std::optional<Arg> lhs_opt = consumeValue();
-		if (!lhs_opt) {
-			errorAtCurrent("Invalid left comparison value in if-conditional");
-			return;
-		}
-		Arg& lhs = lhs_opt.value();
-		u32 op = INS::JMP;
-		switch (current.type) {
-		case TOKEN::EQ_EQ: op = INS::JMP_NEQ; break;
-		case TOKEN::NOT_EQ: op = INS::JMP_EQU; break;
-		case TOKEN::GT: op = INS::JMP_LTE; break;
-		case TOKEN::GTE: op = INS::JMP_LT; break;
-		case TOKEN::LT: op = INS::JMP_GTE; break;
-		case TOKEN::LTE: op = INS::JMP_GT; break;
-		default: errorAtCurrent("Expected comparison operator"); return;
-		}
-		op += is_f ? 1 : 0;
-
-		advance();
-		
-		std::optional<Arg> rhs_opt = consumeValue();
-		if (!rhs_opt) {
-			errorAtCurrent("Invalid right comparison value in if-conditional");
-			return;
-		}
-		Arg& rhs = rhs_opt.value();
-
 		i32 time = sub.time;
-		Ins jmpToElseIns{
-			{time, -1, -1, op, 5},
-			{
-				{AT::CNST, 0},
-				{AT::VTREF, VTID::CLOCK},
-				lhs,
-				rhs,
-				{AT::CNST, max(lhs.val.f, rhs.val.f) * DEFAULT_EPSILON_FACTOR}
-			}};
-		sub.writeIns(jmpToElseIns);
-		u32 jmpToElsePosPos = sub.code.size() - 9;
+		std::optional<Ins> jmpToElseIns = conditionJump(sub, is_f, time);
+		if (!jmpToElseIns) return;
+		sub.writeIns(jmpToElseIns.value());
+		u32 jmpToElsePosPos = sub.size() - 9;
 
 		consume(TOKEN::LBR, "Expected opening bracket");
 		subLevel();
@@ -550,9 +538,9 @@ namespace ZDrive::Compiler {
 				{AT::VTREF, VTID::CLOCK}
 			}};
 		sub.writeIns(jmpToAfterIns);
-		u32 jmpToAfterPosPos = sub.code.size() - 3;
+		u32 jmpToAfterPosPos = sub.size() - 3;
 
-		sub.code[jmpToElsePosPos] = sub.code.size();
+		sub.at(jmpToElsePosPos) = sub.size();
 
 		if (check(TOKEN::ELSE)) {
 			advance();
@@ -565,12 +553,13 @@ namespace ZDrive::Compiler {
 			}
 		}
 
-		sub.code[jmpToAfterPosPos] = sub.code.size();
+		sub.at(jmpToAfterPosPos) = sub.size();
 	}
 
 	void _Compiler::loopStatement() {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
+		u32 line = current.line;
 		advance();
 		consume(TOKEN::VTID, "Expected VTID");
 		std::optional<u32> vtid_opt = extractId(previous);
@@ -579,13 +568,18 @@ namespace ZDrive::Compiler {
 			return;
 		}
 		u32 vtid = vtid_opt.value();
-		u32 jmpBackPos = sub.code.size();
+		u32 jmpBackPos = sub.size();
 		i32 time = sub.time;
 
 		consume(TOKEN::LBR, "Expected opening bracket");
 		subLevel();
 		consume(TOKEN::RBR, "Expected closing bracket");
 
+		// counting down always ends, unless the body keeps setting the counter back up.
+		if (!panicMode && !bodyLetsTimePass(sub, jmpBackPos, jmpBackPos, time) && bodyWrites(sub, jmpBackPos, std::span(&vtid, 1))) {
+			Log(LL::Warn) << "[line " << line << "] Loop writes its own counter and never waits, so it may never finish and stall the frame it's entered on.";
+		}
+
 		Ins jmpBackIns{
 			{time, -1, -1, INS::LOOP, 3},
 			{
@@ -600,13 +594,156 @@ namespace ZDrive::Compiler {
 		ASSERT_CURRENT_SUB_EXISTS(sub);
 
 		bool is_f = current.type == TOKEN::WHILE_F;
+		u32 line = current.line;
+		advance();
+		i32 time = sub.time;
+		// the condition's code runs again every time around.
+		u32 conditionPos = sub.size();
+		std::optional<Ins> jmpToAfterIns = conditionJump(sub, is_f, time);
+		if (!jmpToAfterIns) return;
+		sub.writeIns(jmpToAfterIns.value());
+		u32 jmpToAfterPosPos = sub.size() - 9;
+		u32 bodyStart = sub.size();
+
+		// the vars the condition reads. If the body never waits, it has to change one of them to ever get out.
+		std::vector<u32> read;
+		bool random = false;
+		for (ExprNode const& node : expr) {
+			if (node.kind != ExprNode::LEAF || node.arg.type != AT::VTREF) continue;
+			read.push_back(node.arg.val.u);
+			random |= node.arg.val.u >= VTID::RAND && node.arg.val.u <= VTID::RANDRAD;
+		}
+
+		consume(TOKEN::LBR, "Expected opening bracket");
+		subLevel();
+		consume(TOKEN::RBR, "Expected closing bracket");
+
+		if (!panicMode && !random && !bodyLetsTimePass(sub, conditionPos, bodyStart, time) && !bodyWrites(sub, bodyStart, read)) {
+			Log(LL::Warn) << "[line " << line << "] Loop never waits and nothing in it changes its condition, so once it's entered it never finishes and stalls the frame.";
+		}
+
+		Ins jmpToCondIns{
+			{time, -1, -1, INS::JMP, 2},
+			{
+				{AT::CNST, conditionPos},
+				{AT::VTREF, VTID::CLOCK}
+			}};
+		sub.writeIns(jmpToCondIns);
+
+		sub.at(jmpToAfterPosPos) = sub.size();
+	}
+
+	bool _Compiler::bodyLetsTimePass(Sub const& sub, u32 loopStart, u32 bodyStart, i32 time) {
+		std::span<const i32> code = sub.code();
+		for (u32 offset = bodyStart; offset + INS_HEADER_SIZE <= code.size(); ) {
+			Ins ins(code.begin() + offset);
+			offset += static_cast<u32>(ins.size());
+			if (ins.header.time > time) return true;
+			OpInfo const* op = GetOp(ins.header.ins);
+			// a custom instruction could do anything.
+			if (!op || op->has(OpFlags::STOPS)) return true;
+			if (ins.header.ins == INS::WAIT && !ins.args.empty() && (ins.args[0].type != AT::CNST || ins.args[0].val.s > 0)) return true;
+			if (!op->has(OpFlags::JUMPS)) continue;
+			// labels aren't resolved yet, so a jump to one may well go out.
+			std::optional<u32> pos = op->operand(OperandKind::POS);
+			if (!pos || pos.value() >= ins.args.size()) return true;
+			Arg const& target = ins.args[pos.value()];
+			if (target.type != AT::CNST || target.val.u < loopStart || target.val.u > code.size()) return true;
+		}
+		return false;
+	}
+
+	bool _Compiler::bodyWrites(Sub const& sub, u32 bodyStart, std::span<const u32> vars) {
+		std::span<const i32> code = sub.code();
+		for (u32 offset = bodyStart; offset + INS_HEADER_SIZE <= code.size(); ) {
+			Ins ins(code.begin() + offset);
+			offset += static_cast<u32>(ins.size());
+			OpInfo const* op = GetOp(ins.header.ins);
+			if (!op) return true;
+			for (u32 i = 0; i < op->arity && i < ins.args.size(); i++) {
+				if (op->operands[i] != OperandKind::DEST && op->operands[i] != OperandKind::INOUT) continue;
+				bool vec2 = isVec2Arg(op->code, i);
+				Arg const& arg = ins.args[i];
+				// temporaries are the compiler's own, the condition can't read them.
+				if (arg.type == AT::TEMP_VAR || arg.type == AT::TEMP_VAR_REF) continue;
+				if (arg.type != AT::CNST) return true;
+				for (u32 var : vars) {
+					if (var == arg.val.u || (vec2 && var == arg.val.u + 1)) return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// until cond; waits for cond to be true. Instead of polling, the routine sleeps until one of the vars in cond is written.
+	void _Compiler::untilStatement() {
+		ASSERT_CURRENT_SUB_EXISTS(sub);
+
+		bool is_f = current.type == TOKEN::UNTIL_F;
 		advance();
-		std::optional<Arg> lhs_opt = consumeValue();
-		if (!lhs_opt) {
-			errorAtCurrent("Invalid left comparison value in if-conditional");
+		i32 time = sub.time;
+		u32 conditionPos = sub.size();
+		std::optional<Ins> waitIns = conditionJump(sub, is_f, time);
+		consume(TOKEN::SEMICOLON, "Expected semicolon");
+		if (!waitIns || panicMode) return;
+
+		// the jump is taken for as long as cond is false, which is what WAIT_UNTIL waits out. The position is where the code working out cond starts.
+		std::vector<Arg>& args = waitIns.value().args;
+		args[0] = { AT::CNST, conditionPos };
+		args.insert(args.begin() + 2, { AT::CNST, waitIns.value().header.ins });
+		waitIns.value().header.ins = INS::WAIT_UNTIL;
+		// then the vars that can make cond change.
+		std::vector<u32> watched;
+		for (ExprNode const& node : expr) {
+			if (node.kind != ExprNode::LEAF || node.arg.type != AT::VTREF || std::ranges::find(watched, node.arg.val.u) != watched.end()) continue;
+			watched.push_back(node.arg.val.u);
+			args.push_back({ AT::CNST, node.arg.val.u });
+		}
+		waitIns.value().header.arg_count = static_cast<u32>(args.size());
+		sub.writeIns(waitIns.value());
+	}
+
+	void _Compiler::assignment() {
+		ASSERT_CURRENT_SUB_EXISTS(sub);
+
+		expr.clear();
+		tempsInUse = {};
+		Arg dest = argument();
+
+		TokenType op = TOKEN::EQ;
+		if (check(TOKEN::PLUS) || check(TOKEN::MINUS) || check(TOKEN::STAR) || check(TOKEN::SLASH) || check(TOKEN::MOD)) {
+			op = current.type;
+			advance();
+		}
+		consume(TOKEN::EQ, "Expected '='");
+		u32 root = expression();
+		consume(TOKEN::SEMICOLON, "Expected semicolon");
+		if (panicMode) return;
+
+		std::optional<NumType> destType = dest.type == AT::CNST ? slotType(dest.val.u) : std::nullopt;
+		NumType type = destType.value_or(inferType(root));
+		if (!prepare(root, type)) return;
+
+		InsHead head{ sub.time, sub.diff, sub.rank, INS::NOP, 0 };
+		if (op == TOKEN::EQ) {
+			emitExpr(sub, root, type, head, dest);
 			return;
 		}
-		Arg& lhs = lhs_opt.value();
+
+		// dest is read by the instruction doing op, so the rhs can't be built in it.
+		Arg val = emitExpr(sub, root, type, head, std::nullopt);
+		if (type == NumType::INT && val.type == AT::CNST && val.val.s == 1 && (op == TOKEN::PLUS || op == TOKEN::MINUS)) {
+			emitOp(sub, head, op == TOKEN::PLUS ? INS::IINC : INS::IDEC, { dest });
+		} else {
+			emitOp(sub, head, selfOpcode(op, type), { dest, val });
+		}
+	}
+
+	std::optional<Ins> _Compiler::conditionJump(Sub& sub, bool isFloat, i32 time) {
+		expr.clear();
+		tempsInUse = {};
+		u32 lhsNode = expression();
+
 		u32 op = INS::JMP;
 		switch (current.type) {
 		case TOKEN::EQ_EQ: op = INS::JMP_NEQ; break;
@@ -615,23 +752,20 @@ namespace ZDrive::Compiler {
 		case TOKEN::GTE: op = INS::JMP_LT; break;
 		case TOKEN::LT: op = INS::JMP_GTE; break;
 		case TOKEN::LTE: op = INS::JMP_GT; break;
-		default: errorAtCurrent("Expected comparison operator"); return;
+		default: errorAtCurrent("Expected comparison operator"); return std::nullopt;
 		}
-		op += is_f ? 1 : 0;
-
+		op += isFloat ? 1 : 0;
 		advance();
 
-		std::optional<Arg> rhs_opt = consumeValue();
-		if (!rhs_opt) {
-			errorAtCurrent("Invalid right comparison value in if-conditional");
-			return;
-		}
-		Arg& rhs = rhs_opt.value();
-
-		i32 time = sub.time;
-		u32 conditionPos = sub.code.size();
+		u32 rhsNode = expression();
+		NumType type = isFloat ? NumType::FLOAT : NumType::INT;
+		if (panicMode || !prepare(lhsNode, type) || !prepare(rhsNode, type)) return std::nullopt;
 
-		Ins jmpToAfterIns{
+		// the comparison is the jump itself, so each side only needs computing if it isn't a plain value already.
+		InsHead head{ time, -1, -1, INS::NOP, 0 };
+		Arg lhs = emitExpr(sub, lhsNode, type, head, std::nullopt);
+		Arg rhs = emitExpr(sub, rhsNode, type, head, std::nullopt);
+		return Ins{
 			{time, -1, -1, op, 5},
 			{
 				{AT::CNST, 0},
@@ -640,21 +774,5 @@ namespace ZDrive::Compiler {
 				rhs,
 				{AT::CNST, max(lhs.val.f, rhs.val.f) * DEFAULT_EPSILON_FACTOR}
 			}};
-		sub.writeIns(jmpToAfterIns);
-		u32 jmpToAfterPosPos = sub.code.size() - 9;
-
-		consume(TOKEN::LBR, "Expected opening bracket");
-		subLevel();
-		consume(TOKEN::RBR, "Expected closing bracket");
-
-		Ins jmpToCondIns{
-			{time, -1, -1, INS::JMP, 2},
-			{
-				{AT::CNST, conditionPos},
-				{AT::VTREF, VTID::CLOCK}
-			}};
-		sub.writeIns(jmpToCondIns);
-
-		sub.code[jmpToAfterPosPos] = sub.code.size();
 	}
 }
\ No newline at end of file
@@ -6,23 +6,37 @@
 #include <string_view>
 
 #include "defs.hpp"
+#include "expr.hpp"
+#include "passes.hpp"
 #include "scanner.hpp"
+#include "symbols.hpp"
 
 namespace ZDrive::Compiler {
 	class _Compiler {
 	public:
-		_Compiler(LanguageDeclaration const& langDecl, std::string const& source, std::string const& entrySubName);
-		std::vector<i32> operator()();
+		_Compiler(LanguageDeclaration const& langDecl, std::string const& source, std::string const& moduleName, CompileOptions const& options = {});
+		std::optional<ObjectModule> operator()();
 
 		static constexpr f32 DEFAULT_EPSILON_FACTOR = 0.0009765625f; // 1/1024 (approx. 0.1% error range)
 	private:
 
 		LangDecl const& lang;
 		std::string const& src;
-		std::string const& entryName;
+		std::string const& moduleName;
+		CompileOptions options;
 
-		std::unordered_map<std::string, Token> bindings;
+		Interner names;
+		SymbolTable symbols;
 		std::vector<Sub> subs;
+		// the code of every sub, one after another. Becomes the module's code.
+		std::vector<i32> arena;
+		// every sub call, as <sym, line>. Calls are written with a TEMP_SUB arg holding an index into this,
+		// which becomes a relocation once the sub's code is final.
+		std::vector<std::pair<u32, u32>> subRefs;
+		// nodes of the expression being compiled. Cleared by every statement that has one.
+		std::vector<ExprNode> expr;
+		// how many temporaries of each NumType are taken at the current point of the statement.
+		std::array<u32, 2> tempsInUse{};
 		inline std::optional<std::reference_wrapper<Sub>> currentSub() { return (subs.size() > 0 && subs.back().nestLevel > -1)? std::optional<std::reference_wrapper<Sub>>{subs.back()} : std::nullopt; }
 
 		Token current;
@@ -33,9 +47,17 @@ namespace ZDrive::Compiler {
 		Scanner scanner;
 
 		static u32 strToU32(std::string_view const& str);
+		// these don't need the str to be null terminated, unlike strtol and friends.
+		static i64 readInt(std::string_view str);
+		static f32 readFloat(std::string_view str);
 		static Value readIntToken(Token const& token);
 		std::optional<u32> extractId(Token const& token);
-		std::optional<std::reference_wrapper<Sub>> findSub(std::string name);
+
+		// returns false if a label wasn't found.
+		bool resolveLabels(Sub& sub);
+		// turns the placeholder temporaries of the sub's expressions into LI/LF slots the sub doesn't use.
+		// returns false if there aren't enough.
+		bool allocateTemps(Sub& sub);
 
 		void errorAt(Token& token, std::string const& message);
 		//void errorAtPrevious(std::string message);
@@ -53,7 +75,7 @@ namespace ZDrive::Compiler {
 		void subDecl();
 		void subLevel();
 		void funcCall(InsDecl func);
-		void subCall(Sub const& sub);
+		void subCall(u32 sym);
 		Arg argument();
 		std::optional<Arg> consumeValue();
 		void label();
@@ -63,5 +85,34 @@ namespace ZDrive::Compiler {
 		void ifStatement();
 		void loopStatement();
 		void whileStatement();
+		void untilStatement();
+		// whether a loop body, from bodyStart to the end of the sub so far, can let time pass: wait, stop, reach a later timestamp or jump out of the loop.
+		// loopStart is where its jump back goes and time is the time it jumps back to.
+		static bool bodyLetsTimePass(Sub const& sub, u32 loopStart, u32 bodyStart, i32 time);
+		// whether a loop body writes any of vars, or a var only known at runtime.
+		static bool bodyWrites(Sub const& sub, u32 bodyStart, std::span<const u32> vars);
+		void assignment();
+		// parses "lhs op rhs", writes the code computing both sides, and returns the jump taken when the comparison is false.
+		std::optional<Ins> conditionJump(Sub& sub, bool isFloat, i32 time);
+
+		// expr.cpp. Parsing only builds the tree, since what type the arithmetic is in may depend on the whole of it.
+		u32 addNode(ExprNode const& node);
+		u32 expression();
+		u32 term();
+		u32 unary();
+		u32 primary();
+		// float if anything in the tree is, int otherwise. For when the destination doesn't say.
+		NumType inferType(u32 node) const;
+		// converts constants to type, folds what can be folded and works out the order to evaluate things in.
+		bool prepare(u32 node, NumType type);
+		bool reads(u32 node, u32 vtid) const;
+		// whether dest can hold an intermediate result while other is still to be evaluated.
+		bool canScratch(Arg const& dest, std::optional<u32> other) const;
+		Arg newTemp(Sub& sub, NumType type);
+		static void emitOp(Sub& sub, InsHead head, u32 opcode, std::vector<Arg> args);
+		// writes the code for a prepared node. The result goes in into if given, otherwise it's a constant, a var ref or a temporary.
+		// Returns something to read it with.
+		Arg emitExpr(Sub& sub, u32 node, NumType type, InsHead const& head, std::optional<Arg> into);
+		static Arg readOf(Arg const& dest);
 	};
 }
\ No newline at end of file
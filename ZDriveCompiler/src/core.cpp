@@ -37,7 +37,16 @@ namespace ZDrive::Compiler {
 		for (Arg const& arg : ins.args) writeArg(dest, arg);
 	}
 
-	void writeAll(std::vector<i32>& dest, std::vector<i32> const& src) {
-		dest.insert(dest.end(), src.begin(), src.end());
+	i32* writeIns(i32* dest, Ins const& ins) {
+		*dest++ = ins.header.time;
+		*dest++ = ins.header.diff_mask;
+		*dest++ = ins.header.rank_mask;
+		*dest++ = ins.header.ins;
+		*dest++ = static_cast<i32>(ins.header.arg_count);
+		for (Arg const& arg : ins.args) {
+			*dest++ = static_cast<i32>(arg.type);
+			*dest++ = arg.val.s;
+		}
+		return dest;
 	}
 }
\ No newline at end of file
@@ -9,5 +9,6 @@ namespace ZDrive::Compiler {
 	void writeArg(std::vector<i32>& dest, Arg const& arg);
 	void writeInsHead(std::vector<i32>& dest, InsHead const& head);
 	void writeIns(std::vector<i32>& dest, Ins const& ins);
-	void writeAll(std::vector<i32>& dest, std::vector<i32> const& src);
+	// for writing over code that's already there. Returns where whatever comes next goes.
+	i32* writeIns(i32* dest, Ins const& ins);
 }
\ No newline at end of file
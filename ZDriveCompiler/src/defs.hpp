@@ -18,7 +18,7 @@ namespace ZDrive::Compiler {
 
 		IDENTIFIER, INT, FLOAT, VTID, PTR, LABEL, TIMESTAMP, RANK, DIFF,
 
-		IF, IF_F, ELSE, SUB, LOOP, WHILE, WHILE_F,
+		IF, IF_F, ELSE, SUB, LOOP, WHILE, WHILE_F, UNTIL, UNTIL_F,
 
 		BIND,
 
@@ -26,32 +26,54 @@ namespace ZDrive::Compiler {
 	};
 	using TOKEN = TokenType;
 
+	// str views into the source (or an Interner), so tokens are cheap to copy around.
 	struct Token {
 		TokenType type = TOKEN::ERR;
-		std::string str;
+		std::string_view str;
 		u32 line = 0;
+		// interned name of identifiers, labels and $name VTIDs, Interner::NONE otherwise.
+		u32 sym = 0;
 	};
 
+	struct LabelRef {
+		u32 sym;
+		u32 pos; // of the arg in the sub's code
+		u32 line;
+	};
+
+	// what an expression's arithmetic is done in. Vars don't have types, so like with instructions, the statement decides.
+	enum class NumType : u8 { INT, FLOAT };
+
 	struct Sub {
 		std::string name;
 		u32 id = 0;
 		i32 type = 0;
-		u32 pos = 0;
-		std::unordered_map<std::string, Token> bindings;
-		std::unordered_map<std::string, u32> labels; // labels["smth"] returns the offset label smth refers to
-		std::unordered_map<std::string, std::vector<std::pair<u32, u32>>> labelRefs; // labelRefs["smth"] returns a list of <offsets, line numbers> of all args that reference label smth
+		// the module's code. Subs are written to it one after another, so only the last one ever grows.
+		std::vector<i32>* arena = nullptr;
+		// where the sub's code is in arena.
+		u32 start = 0;
+		u32 length = 0;
+		std::vector<std::pair<u32, u32>> labels; // <interned name, offset> of each label in order of declaration. A redeclared label moves.
+		std::vector<LabelRef> labelRefs; // every arg that references a label
 		i32 nestLevel = -1;
 		i32 time = 0;
 		i32 rank = -1;
 		i32 diff = -1;
-		std::vector<i32> code;
-
-		inline void writeSingle(Value const& value) { Compiler::writeSingle(code, value); }
-		inline void writeVal(Value const& value) { Compiler::writeVal(code, value); }
-		inline void writeVar(Value const& vtid) { Compiler::writeVar(code, vtid); }
-		inline void writeArg(Arg const& arg) { Compiler::writeArg(code, arg); }
-		inline void writeInsHead(InsHead const& head) { Compiler::writeInsHead(code, head); }
-		inline void writeIns(Ins const& ins) { Compiler::writeIns(code, ins); }
-		inline void writeAll(std::vector<i32> const& src) { Compiler::writeAll(code, src); }
+		// the most temporaries of each NumType any one statement needed.
+		std::array<u32, 2> temps{};
+
+		inline u32 size() const { return length; }
+		inline i32& at(u32 pos) { return (*arena)[start + pos]; }
+		inline std::span<i32> code() { return std::span(*arena).subspan(start, length); }
+		inline std::span<const i32> code() const { return std::span<const i32>(*arena).subspan(start, length); }
+
+		inline void writeSingle(Value const& value) { Compiler::writeSingle(*arena, value); grown(); }
+		inline void writeVal(Value const& value) { Compiler::writeVal(*arena, value); grown(); }
+		inline void writeVar(Value const& vtid) { Compiler::writeVar(*arena, vtid); grown(); }
+		inline void writeArg(Arg const& arg) { Compiler::writeArg(*arena, arg); grown(); }
+		inline void writeInsHead(InsHead const& head) { Compiler::writeInsHead(*arena, head); grown(); }
+		inline void writeIns(Ins const& ins) { Compiler::writeIns(*arena, ins); grown(); }
+	private:
+		inline void grown() { length = static_cast<u32>(arena->size()) - start; }
 	};
 }
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "ZDriveCompiler.hpp"
+
+#include "compiler.hpp"
+#include "expr.hpp"
+#include "ir.hpp"
+
+namespace ZDrive::Compiler {
+	using namespace Logger;
+
+	namespace {
+		bool isOne(Arg const& arg, NumType type) {
+			return arg.type == AT::CNST && (type == NumType::INT ? arg.val.s == 1 : arg.val.f == 1.0f);
+		}
+
+		// calls fn(pos, kind, vec2) for every arg of every instruction in the sub, with kind the operand kind if the instruction is a base one
+		// and vec2 whether the arg is a 2D vector (see isVec2Arg).
+		template <typename Fn>
+		void forEachArg(Sub& sub, Fn fn) {
+			for (u32 offset = 0; offset + INS_HEADER_SIZE <= sub.size(); ) {
+				OpInfo const* op = GetOp(sub.at(offset + INS_CODE));
+				u32 argc = sub.at(offset + INS_ARGCOUNT);
+				for (u32 i = 0; i < argc; i++) {
+					std::optional<OperandKind> kind;
+					if (op && i < op->arity) kind = op->operands[i];
+					fn(offset + INS_HEADER_SIZE + i * 2, kind, isVec2Arg(sub.at(offset + INS_CODE), i));
+				}
+				offset += INS_HEADER_SIZE + argc * 2;
+			}
+		}
+	}
+
+	std::optional<NumType> slotType(u32 vtid) {
+		if ((vtid >= VTID::I0 && vtid <= VTID::LI7) || vtid == VTID::RAND) return NumType::INT;
+		if (vtid >= VTID::DIFF && vtid <= VTID::CLOCK) return NumType::INT;
+		if ((vtid >= VTID::F0 && vtid <= VTID::LF7) || (vtid >= VTID::RANDF && vtid <= VTID::RANDRAD)) return NumType::FLOAT;
+		return std::nullopt;
+	}
+
+	u32 setOpcode(TokenType op, NumType type) {
+		u32 ret = INS::ISET_ADD;
+		switch (op) {
+		case TOKEN::PLUS: ret = INS::ISET_ADD; break;
+		case TOKEN::MINUS: ret = INS::ISET_SUB; break;
+		case TOKEN::STAR: ret = INS::ISET_MUL; break;
+		case TOKEN::SLASH: ret = INS::ISET_DIV; break;
+		case TOKEN::MOD: ret = INS::ISET_MOD; break;
+		default: break;
+		}
+		return type == NumType::FLOAT ? ret - INS::ISET_ADD + INS::FSET_ADD : ret;
+	}
+
+	u32 selfOpcode(TokenType op, NumType type) {
+		u32 ret = INS::IADD;
+		switch (op) {
+		case TOKEN::PLUS: ret = INS::IADD; break;
+		case TOKEN::MINUS: ret = INS::ISUB; break;
+		case TOKEN::STAR: ret = INS::IMUL; break;
+		case TOKEN::SLASH: ret = INS::IDIV; break;
+		case TOKEN::MOD: ret = INS::IMOD; break;
+		default: break;
+		}
+		return type == NumType::FLOAT ? ret - INS::IADD + INS::FADD : ret;
+	}
+
+	////////////////////////////////////////////////////
+
+	u32 _Compiler::addNode(ExprNode const& node) {
+		expr.push_back(node);
+		return static_cast<u32>(expr.size() - 1);
+	}
+
+	u32 _Compiler::expression() {
+		u32 lhs = term();
+		for (;;) {
+			TokenType op;
+			if (match(TOKEN::PLUS)) op = TOKEN::PLUS;
+			else if (match(TOKEN::MINUS)) op = TOKEN::MINUS;
+			// the scanner reads the "-1" in "$x -1" as one number.
+			else if ((check(TOKEN::INT) || check(TOKEN::FLOAT)) && current.str.starts_with('-')) {
+				current.str.remove_prefix(1);
+				op = TOKEN::MINUS;
+			} else break;
+			lhs = addNode({ .kind = ExprNode::BINARY, .op = op, .lhs = lhs, .rhs = term() });
+		}
+		return lhs;
+	}
+
+	u32 _Compiler::term() {
+		u32 lhs = unary();
+		while (check(TOKEN::STAR) || check(TOKEN::SLASH) || check(TOKEN::MOD)) {
+			TokenType op = current.type;
+			advance();
+			lhs = addNode({ .kind = ExprNode::BINARY, .op = op, .lhs = lhs, .rhs = unary() });
+		}
+		return lhs;
+	}
+
+	u32 _Compiler::unary() {
+		if (match(TOKEN::MINUS)) return addNode({ .kind = ExprNode::NEG, .op = TOKEN::MINUS, .lhs = unary() });
+		return primary();
+	}
+
+	u32 _Compiler::primary() {
+		if (match(TOKEN::LPR)) {
+			u32 inner = expression();
+			consume(TOKEN::RPR, "Expected right parenthesis");
+			return inner;
+		}
+
+		// anything else is left for whatever comes after the expression to deal with.
+		if (!check(TOKEN::VTID) && !check(TOKEN::INT) && !check(TOKEN::FLOAT)) {
+			errorAtCurrent("Expected a value");
+			return addNode({});
+		}
+
+		advance();
+		switch (previous.type) {
+		case TOKEN::VTID: {
+			std::optional<u32> id = extractId(previous);
+			if (!id) return addNode({});
+			return addNode({ .arg = {AT::VTREF, id.value()} });
+		}
+		case TOKEN::FLOAT:
+			return addNode({ .arg = {AT::CNST, readFloat(previous.str)}, .floatLiteral = true });
+		default:
+			return addNode({ .arg = {AT::CNST, readIntToken(previous)} });
+		}
+	}
+
+	NumType _Compiler::inferType(u32 n) const {
+		ExprNode const& node = expr[n];
+		if (node.kind != ExprNode::LEAF) {
+			if (inferType(node.lhs) == NumType::FLOAT) return NumType::FLOAT;
+			return node.kind == ExprNode::BINARY ? inferType(node.rhs) : NumType::INT;
+		}
+		if (node.floatLiteral) return NumType::FLOAT;
+		if (node.arg.type == AT::VTREF) return slotType(node.arg.val.u).value_or(NumType::INT);
+		return NumType::INT;
+	}
+
+	bool _Compiler::prepare(u32 n, NumType type) {
+		ExprNode& node = expr[n];
+		if (node.kind == ExprNode::LEAF) {
+			if (node.arg.type != AT::CNST) return true;
+			if (type == NumType::INT && node.floatLiteral) {
+				errorAt(previous, "Float constant in an int expression");
+				return false;
+			}
+			if (type == NumType::FLOAT && !node.floatLiteral) node.arg.val = static_cast<f32>(node.arg.val.s);
+			node.floatLiteral = type == NumType::FLOAT;
+			return true;
+		}
+
+		if (!prepare(node.lhs, type)) return false;
+		ExprNode const& lhs = expr[node.lhs];
+		if (node.kind == ExprNode::NEG) {
+			if (lhs.kind == ExprNode::LEAF && lhs.arg.type == AT::CNST) {
+				Value val = type == NumType::INT ? Value(0u - lhs.arg.val.u) : Value(-lhs.arg.val.f);
+				node = { .arg = {AT::CNST, val}, .floatLiteral = type == NumType::FLOAT };
+				return true;
+			}
+			node.need = max(lhs.need, 1u);
+			return true;
+		}
+
+		if (!prepare(node.rhs, type)) return false;
+		ExprNode const& rhs = expr[node.rhs];
+		// x - -y is x + y and x + -y is x - y. For *, the sign can go on a constant instead, and for / too except with ints,
+		// where -x overflows for INT32_MIN.
+		if (rhs.kind == ExprNode::NEG && (node.op == TOKEN::PLUS || node.op == TOKEN::MINUS)) {
+			node.op = node.op == TOKEN::PLUS ? TOKEN::MINUS : TOKEN::PLUS;
+			node.rhs = rhs.lhs;
+			return prepare(n, type);
+		}
+		if (node.op == TOKEN::STAR || (node.op == TOKEN::SLASH && type == NumType::FLOAT)) {
+			u32 neg = lhs.kind == ExprNode::NEG ? node.lhs : rhs.kind == ExprNode::NEG ? node.rhs : UINT32_MAX;
+			u32 other = neg == node.lhs ? node.rhs : node.lhs;
+			if (neg != UINT32_MAX && expr[other].kind == ExprNode::LEAF && expr[other].arg.type == AT::CNST) {
+				Value& val = expr[other].arg.val;
+				val = type == NumType::INT ? Value(0u - val.u) : Value(-val.f);
+				(neg == node.lhs ? node.lhs : node.rhs) = expr[neg].lhs;
+				return prepare(n, type);
+			}
+		}
+
+		bool lhsConst = lhs.kind == ExprNode::LEAF && lhs.arg.type == AT::CNST;
+		bool rhsConst = rhs.kind == ExprNode::LEAF && rhs.arg.type == AT::CNST;
+		if (type == NumType::INT && rhsConst && rhs.arg.val.s == 0 && (node.op == TOKEN::SLASH || node.op == TOKEN::MOD)) {
+			errorAt(previous, "Division by zero");
+			return false;
+		}
+		if (lhsConst && rhsConst) {
+			if (auto val = foldBinary(setOpcode(node.op, type), lhs.arg.val, rhs.arg.val)) {
+				node = { .arg = {AT::CNST, val.value()}, .floatLiteral = type == NumType::FLOAT };
+				return true;
+			}
+		}
+
+		// x + 0, x - 0, x * 1 and x / 1 are just x. 0 isn't dropped from floats, since -0.0 + 0.0 is 0.0.
+		bool rhsZero = type == NumType::INT && rhsConst && rhs.arg.val.s == 0;
+		bool lhsZero = type == NumType::INT && lhsConst && lhs.arg.val.s == 0;
+		if ((rhsZero && (node.op == TOKEN::PLUS || node.op == TOKEN::MINUS)) || (isOne(rhs.arg, type) && rhs.kind == ExprNode::LEAF && (node.op == TOKEN::STAR || node.op == TOKEN::SLASH))) {
+			node = ExprNode(lhs);
+			return true;
+		}
+		if ((lhsZero && node.op == TOKEN::PLUS) || (isOne(lhs.arg, type) && lhs.kind == ExprNode::LEAF && node.op == TOKEN::STAR)) {
+			node = ExprNode(rhs);
+			return true;
+		}
+
+		// Sethi-Ullman: the side that needs more goes first, so its temporaries are free again by the time the other side runs.
+		node.need = lhs.need == rhs.need ? lhs.need + 1 : max(lhs.need, rhs.need);
+		return true;
+	}
+
+	bool _Compiler::reads(u32 n, u32 vtid) const {
+		ExprNode const& node = expr[n];
+		switch (node.kind) {
+		case ExprNode::LEAF: return node.arg.type == AT::VTREF && node.arg.val.u == vtid;
+		case ExprNode::NEG: return reads(node.lhs, vtid);
+		default: return reads(node.lhs, vtid) || reads(node.rhs, vtid);
+		}
+	}
+
+	bool _Compiler::canScratch(Arg const& dest, std::optional<u32> other) const {
+		if (dest.type == AT::TEMP_VAR) return true;
+		// a var the sub can see is fine to use early as long as nothing still to be evaluated reads it, and writing it
+		// doesn't do anything on its own, which rules out everything from RAND on.
+		if (dest.type != AT::CNST || dest.val.u >= VTID::RAND || ValPtr(dest.val.u).b) return false;
+		return !other || !reads(other.value(), dest.val.u);
+	}
+
+	Arg _Compiler::newTemp(Sub& sub, NumType type) {
+		u32& inUse = tempsInUse[static_cast<u32>(type)];
+		u32 index = inUse++;
+		u32& most = sub.temps[static_cast<u32>(type)];
+		most = max(most, inUse);
+		return { AT::TEMP_VAR, (type == NumType::INT ? VTID::LI0 : VTID::LF0) + index };
+	}
+
+	void _Compiler::emitOp(Sub& sub, InsHead head, u32 opcode, std::vector<Arg> args) {
+		head.ins = opcode;
+		head.arg_count = static_cast<u32>(args.size());
+		sub.writeIns(Ins(head, std::move(args)));
+	}
+
+	Arg _Compiler::emitExpr(Sub& sub, u32 n, NumType type, InsHead const& head, std::optional<Arg> into) {
+		ExprNode const& node = expr[n];
+		if (node.kind == ExprNode::LEAF) {
+			if (!into) return node.arg;
+			emitOp(sub, head, INS::SET, { into.value(), node.arg });
+			return readOf(into.value());
+		}
+
+		Arg dest = into ? into.value() : newTemp(sub, type);
+		// anything the operands take is free again once they've been used.
+		std::array<u32, 2> saved = tempsInUse;
+
+		if (node.kind == ExprNode::NEG) {
+			bool inDest = expr[node.lhs].kind != ExprNode::LEAF && canScratch(dest, std::nullopt);
+			Arg val = emitExpr(sub, node.lhs, type, head, inDest ? std::optional(dest) : std::nullopt);
+			// times -1 instead of 0 - x, so -0.0 stays -0.0.
+			if (type == NumType::FLOAT) emitOp(sub, head, INS::FSET_MUL, { dest, val, {AT::CNST, -1.0f} });
+			else emitOp(sub, head, INS::ISET_SUB, { dest, {AT::CNST, 0}, val });
+		} else {
+			bool rhsFirst = expr[node.rhs].need > expr[node.lhs].need;
+			u32 first = rhsFirst ? node.rhs : node.lhs;
+			u32 second = rhsFirst ? node.lhs : node.rhs;
+			// the first side can be built right in dest, which saves a copy or a temporary.
+			Arg firstVal = emitExpr(sub, first, type, head, expr[first].kind != ExprNode::LEAF && canScratch(dest, second) ? std::optional(dest) : std::nullopt);
+			Arg secondVal = emitExpr(sub, second, type, head, std::nullopt);
+			emitOp(sub, head, setOpcode(node.op, type), { dest, rhsFirst ? secondVal : firstVal, rhsFirst ? firstVal : secondVal });
+		}
+
+		tempsInUse = saved;
+		return readOf(dest);
+	}
+
+	Arg _Compiler::readOf(Arg const& dest) {
+		switch (dest.type) {
+		case AT::TEMP_VAR: return { AT::TEMP_VAR_REF, dest.val };
+		case AT::CNST: return { AT::VTREF, dest.val };
+		// a computed id, which can't be read back.
+		default: return {};
+		}
+	}
+
+	bool _Compiler::allocateTemps(Sub& sub) {
+		if (sub.temps[0] == 0 && sub.temps[1] == 0) return true;
+
+		// a slot is free if nothing in the sub mentions it. Constants that only happen to equal a slot's id count too,
+		// since the args of instructions that aren't base ones could be ids. At worst that wastes a slot.
+		std::array<bool, VTID::LF7 + 1> used{};
+		forEachArg(sub, [&](u32 pos, std::optional<OperandKind> kind, bool vec2) {
+			i32 type = sub.at(pos);
+			u32 val = sub.at(pos + 1);
+			if ((type != AT::CNST && type != AT::VTREF) || val >= used.size()) return;
+			if (kind == OperandKind::POS || kind == OperandKind::TIME || kind == OperandKind::OPCODE || kind == OperandKind::SUB) return;
+			used[val] = true;
+			// vectors use the var after them too.
+			if (vec2 && val + 1 < used.size()) used[val + 1] = true;
+		});
+
+		std::array<std::vector<u32>, 2> slots;
+		for (u32 i = 0; i < 8; i++) {
+			if (!used[VTID::LI0 + i]) slots[0].push_back(VTID::LI0 + i);
+			if (!used[VTID::LF0 + i]) slots[1].push_back(VTID::LF0 + i);
+		}
+		for (u32 t = 0; t < 2; t++) {
+			if (sub.temps[t] <= slots[t].size()) continue;
+			Log(LL::Error) << "Sub '" << sub.name << "' needs " << sub.temps[t] << (t ? " LF" : " LI") << " slots for the temporaries of its expressions, but only "
+				<< slots[t].size() << " are unused. Split up the biggest expression or free up some slots.";
+			return false;
+		}
+
+		forEachArg(sub, [&](u32 pos, std::optional<OperandKind>, bool) {
+			i32 type = sub.at(pos);
+			if (type != AT::TEMP_VAR && type != AT::TEMP_VAR_REF) return;
+			u32 val = sub.at(pos + 1);
+			bool isFloat = val >= VTID::LF0;
+			sub.at(pos) = type == AT::TEMP_VAR ? AT::CNST : AT::VTREF;
+			sub.at(pos + 1) = slots[isFloat][val - (isFloat ? VTID::LF0 : VTID::LI0)];
+		});
+		return true;
+	}
+}
\ No newline at end of file
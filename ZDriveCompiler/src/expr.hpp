@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ZDriveCompiler.hpp"
+
+#include "defs.hpp"
+
+namespace ZDrive::Compiler {
+	// one node of an expression tree. Nodes refer to each other by index into _Compiler::expr.
+	struct ExprNode {
+		enum Kind : u8 {
+			LEAF, // a constant or var ref, in arg
+			BINARY, // lhs op rhs
+			NEG, // -lhs
+		};
+
+		Kind kind = LEAF;
+		TokenType op = TOKEN::PLUS;
+		Arg arg = {};
+		// literals are kept as written until the type of the expression is known, see _Compiler::prepare.
+		bool floatLiteral = false;
+		u32 lhs = 0;
+		u32 rhs = 0;
+		// how many temporaries evaluating it takes, not counting the one it ends up in. Set by prepare.
+		u32 need = 0;
+	};
+
+	// what the base vars hold, if they're meant to hold one thing.
+	std::optional<NumType> slotType(u32 vtid);
+	// the three operand *SET_* instruction for an arithmetic operator.
+	u32 setOpcode(TokenType op, NumType type);
+	// the two operand one that writes back into its first arg, for compound assignments.
+	u32 selfOpcode(TokenType op, NumType type);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#include "ZDriveCompiler.hpp"
+
+#include "interner.hpp"
+
+namespace ZDrive::Compiler {
+	Interner::Interner() {
+		names.emplace_back();
+		ids.emplace(names.back(), NONE);
+	}
+
+	u32 Interner::intern(std::string_view name) {
+		if (auto it = ids.find(name); it != ids.end()) return it->second;
+		u32 id = static_cast<u32>(names.size());
+		names.emplace_back(name);
+		ids.emplace(names.back(), id);
+		return id;
+	}
+}
\ No newline at end of file
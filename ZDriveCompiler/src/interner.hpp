@@ -0,0 +1,25 @@
+#pragma once
+
+#include "ZDriveCompiler.hpp"
+
+#include <deque>
+
+namespace ZDrive::Compiler {
+	// gives every distinct name an id, so names can be hashed and compared as ints.
+	class Interner {
+	public:
+		// the id of the empty string, which tokens that aren't names have.
+		static constexpr u32 NONE = 0;
+
+		Interner();
+
+		u32 intern(std::string_view name);
+		// the view stays valid for as long as the interner does.
+		inline std::string_view name(u32 id) const { return names[id]; }
+		inline usize size() const { return names.size(); }
+	private:
+		// a deque so growing it doesn't move the strings the keys of ids view.
+		std::deque<std::string> names;
+		std::unordered_map<std::string_view, u32> ids;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "ZDriveCompiler.hpp"
+
+#include "ir.hpp"
+
+namespace ZDrive::Compiler {
+	std::optional<u32> jumpArg(u32 opcode) {
+		OpInfo const* op = GetOp(opcode);
+		if (!op) return std::nullopt;
+		return op->operand(OperandKind::POS);
+	}
+
+	std::optional<IRSub> IRSub::lift(std::span<const i32> code) {
+		IRSub ir;
+		std::unordered_map<u32, u32> indexByOffset;
+		for (u32 offset = 0; offset < code.size(); ) {
+			if (offset + INS_HEADER_SIZE > code.size()) return std::nullopt;
+			u32 argc = code[offset + INS_ARGCOUNT];
+			if (offset + INS_HEADER_SIZE + argc * 2 > code.size()) return std::nullopt;
+			indexByOffset[offset] = static_cast<u32>(ir.code.size());
+			ir.code.push_back({ Ins(code.begin() + offset) });
+			offset += static_cast<u32>(ir.code.back().ins.size());
+		}
+		indexByOffset[static_cast<u32>(code.size())] = static_cast<u32>(ir.code.size());
+
+		for (IRIns& i : ir.code) {
+			auto arg = jumpArg(i.ins.header.ins);
+			if (!arg || i.ins.args.size() <= arg.value()) continue;
+			Arg const& target = i.ins.args[arg.value()];
+			// a computed jump could land anywhere.
+			if (target.type != AT::CNST) return std::nullopt;
+			auto index = indexByOffset.find(target.val.u);
+			if (index == indexByOffset.end()) return std::nullopt;
+			i.target = index->second;
+		}
+		return ir;
+	}
+
+	std::optional<IRSub> IRSub::lift(Sub const& sub) {
+		auto ir = lift(sub.code());
+		if (!ir) return std::nullopt;
+
+		// a label used as anything but a jump target is a position that would need relocating, which isn't worth it.
+		std::unordered_set<u32> jumpArgPositions;
+		u32 offset = 0;
+		for (IRIns const& i : ir->code) {
+			if (auto arg = jumpArg(i.ins.header.ins)) jumpArgPositions.insert(offset + INS_HEADER_SIZE + arg.value() * 2);
+			offset += static_cast<u32>(i.ins.size());
+		}
+		for (LabelRef const& ref : sub.labelRefs) if (!jumpArgPositions.contains(ref.pos)) return std::nullopt;
+		return ir;
+	}
+
+	u32 IRSub::size() const {
+		u32 size = 0;
+		for (IRIns const& i : code) size += static_cast<u32>(i.ins.size());
+		return size;
+	}
+
+	void IRSub::lower(std::span<i32> dest) const {
+		std::vector<u32> offsets;
+		offsets.reserve(code.size() + 1);
+		u32 offset = 0;
+		for (IRIns const& i : code) {
+			offsets.push_back(offset);
+			offset += static_cast<u32>(i.ins.size());
+		}
+		offsets.push_back(offset);
+
+		i32* out = dest.data();
+		for (IRIns const& i : code) {
+			out = writeIns(out, i.ins);
+			// the target's offset goes straight over the arg that was just written.
+			if (i.target) *(out - i.ins.size() + INS_HEADER_SIZE + jumpArg(i.ins.header.ins).value() * 2 + 1) = offsets[i.target.value()];
+		}
+	}
+
+	std::vector<bool> IRSub::isTarget() const {
+		std::vector<bool> ret(code.size() + 1, false);
+		for (IRIns const& i : code) {
+			if (i.target) ret[i.target.value()] = true;
+		}
+		return ret;
+	}
+
+	void IRSub::compact() {
+		// newIndex[i] is where instruction i (or the first one after it that survives) ends up.
+		std::vector<u32> newIndex(code.size() + 1);
+		u32 kept = 0;
+		for (u32 i = 0; i < code.size(); i++) {
+			newIndex[i] = kept;
+			if (!code[i].removed) kept++;
+		}
+		newIndex[code.size()] = kept;
+
+		std::vector<IRIns> out;
+		out.reserve(kept);
+		for (IRIns& i : code) {
+			if (i.removed) continue;
+			if (i.target) i.target = newIndex[i.target.value()];
+			out.push_back(std::move(i));
+		}
+		code = std::move(out);
+	}
+
+	bool IRSub::canRemove(u32 i) const {
+		// arriving at i waits for its time, then falls into the next instruction which waits for its own.
+		// the first wait is only redundant if the second one is at least as long.
+		for (u32 next = i + 1; next < code.size(); next++) {
+			if (code[next].removed) continue;
+			return code[next].ins.header.time >= code[i].ins.header.time;
+		}
+		return false;
+	}
+}
\ No newline at end of file
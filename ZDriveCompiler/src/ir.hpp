@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ZDriveCompiler.hpp"
+
+#include "defs.hpp"
+
+namespace ZDrive::Compiler {
+	// one instruction of a sub, with its jump target as an index instead of an offset so instructions can be added and removed freely.
+	struct IRIns {
+		Ins ins;
+		// index of the instruction jumped to, if this is a jump. May be code.size(), ie. the end of the sub.
+		std::optional<u32> target = std::nullopt;
+		// set by passes, see IRSub::compact.
+		bool removed = false;
+	};
+
+	// a sub between parsing and emission. Passes edit code directly and call compact when they're done removing.
+	class IRSub {
+	public:
+		std::vector<IRIns> code;
+
+		// returns nullopt if the code can't be lifted, eg. because it jumps to positions only known at runtime.
+		static std::optional<IRSub> lift(std::span<const i32> code);
+		// same, but also gives up on subs that use labels for anything other than jump targets.
+		static std::optional<IRSub> lift(Sub const& sub);
+		// how many ints lower writes.
+		u32 size() const;
+		// dest has to be at least size() long. It may be where the code was lifted from, since nothing reads that anymore.
+		void lower(std::span<i32> dest) const;
+
+		// isTarget()[i] is whether anything jumps to instruction i.
+		std::vector<bool> isTarget() const;
+		// drops removed instructions. Jumps to one now go to whatever came after it.
+		void compact();
+		// whether instruction i can be dropped without losing the wait its timestamp implies.
+		bool canRemove(u32 i) const;
+	};
+
+	// returns which arg of the opcode is a position in the same sub, if any.
+	std::optional<u32> jumpArg(u32 opcode);
+	// whether the instruction runs no matter what DIFF and RANK are (as long as neither is 0, in which case nothing runs at all).
+	inline bool alwaysRuns(InsHead const& head) { return head.diff_mask == -1 && head.rank_mask == -1; }
+	inline bool sameHeader(InsHead const& a, InsHead const& b) { return a.time == b.time && a.diff_mask == b.diff_mask && a.rank_mask == b.rank_mask; }
+	// writing these changes whether or how the next instruction runs, or reading them has side effects.
+	inline bool isSpecialVar(u32 id) { return id == VTID::CLOCK || id == VTID::TIME || (id >= VTID::RAND && id <= VTID::RANDRAD); }
+}
\ No newline at end of file
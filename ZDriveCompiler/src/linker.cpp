@@ -0,0 +1,209 @@
+#include "ZDriveCompiler.hpp"
+
+#include <bit>
+
+namespace ZDrive::Compiler {
+	using namespace Logger;
+
+	namespace {
+		// the ids FINTERP starts, one bit each.
+		static_assert(DEF_SUB::INTERP_OVER_OUT_E < 32);
+
+		// a sub of one of the modules, under the id it would get without stripping or merging.
+		struct LinkSub {
+			ObjectModule const* module = nullptr;
+			ObjectModule::SubDef const* def = nullptr;
+			std::span<const i32> code = {};
+			// <pos, id of the callee> of every call in it, by pos.
+			std::vector<std::pair<u32, u32>> calls = {};
+			// which DEF_SUB ids it may start through FINTERP.
+			u32 interps = 0;
+			// whether it calls an id that isn't a relocation, eg. call($I0). Link can't follow those, or renumber what they go to.
+			bool dynamicCall = false;
+		};
+
+		void scanSub(LinkSub& sub) {
+			for (u32 offset = 0; offset + INS_HEADER_SIZE <= sub.code.size(); ) {
+				u32 opcode = sub.code[offset + INS_CODE];
+				u32 argc = sub.code[offset + INS_ARGCOUNT];
+				u32 args = offset + INS_HEADER_SIZE;
+				if (args + argc * 2 > sub.code.size()) break;
+				if (OpInfo const* op = GetOp(opcode)) {
+					if (auto subArg = op->operand(OperandKind::SUB); subArg && subArg.value() < argc) {
+						u32 pos = args + subArg.value() * 2 + 1;
+						if (!std::ranges::any_of(sub.calls, [pos](auto const& call) { return call.first == pos; })) sub.dynamicCall = true;
+					}
+					// its third arg is the mode, which is the id of the sub it starts.
+					if (opcode == INS::FINTERP && argc > 2) {
+						u32 mode = sub.code[args + 5];
+						if (sub.code[args + 4] != AT::CNST) sub.interps = ~0u;
+						else if (mode <= DEF_SUB::INTERP_OVER_OUT_E) sub.interps |= 1u << mode;
+					}
+				}
+				offset = args + argc * 2;
+			}
+		}
+
+		// splits subs into classes that would run the same, ie. same type, same code, and calls to subs of the same classes.
+		// returns the class of each sub.
+		std::vector<u32> identicalClasses(std::vector<LinkSub> const& subs) {
+			std::vector<u32> classes(subs.size());
+			std::map<std::pair<i32, std::vector<i32>>, u32> byCode;
+			for (u32 i = 0; i < subs.size(); i++) {
+				// calls are compared by where they go below, so what's in their args doesn't matter.
+				std::vector<i32> code(subs[i].code.begin(), subs[i].code.end());
+				for (auto [pos, callee] : subs[i].calls) code[pos] = 0;
+				classes[i] = byCode.try_emplace({ subs[i].def->type, std::move(code) }, static_cast<u32>(byCode.size())).first->second;
+			}
+
+			// subs that call different classes can't be the same, which may in turn split up their callers, and so on.
+			usize classCount = byCode.size();
+			for (;;) {
+				std::map<std::pair<u32, std::vector<u32>>, u32> byCallees;
+				std::vector<u32> refined(subs.size());
+				for (u32 i = 0; i < subs.size(); i++) {
+					std::vector<u32> callees;
+					callees.reserve(subs[i].calls.size());
+					for (auto [pos, callee] : subs[i].calls) callees.push_back(classes[callee]);
+					refined[i] = byCallees.try_emplace({ classes[i], std::move(callees) }, static_cast<u32>(byCallees.size())).first->second;
+				}
+				classes = std::move(refined);
+				if (byCallees.size() == classCount) break;
+				classCount = byCallees.size();
+			}
+			return classes;
+		}
+	}
+
+	std::vector<i32> Link(std::span<const ObjectModule> modules, std::string const& entrySubName, LinkOptions const& options, std::vector<u32>* newIds) {
+		// <id, index of the module it's from> of the first sub declared with each name.
+		std::unordered_map<std::string_view, std::pair<u32, u32>> subByName;
+		std::vector<LinkSub> subs;
+		for (u32 m = 0; m < modules.size(); m++) {
+			for (ObjectModule::SubDef const& sub : modules[m].subs) {
+				auto [first, added] = subByName.try_emplace(sub.name, static_cast<u32>(subs.size()), m);
+				// the compiler already warned about duplicates within a module.
+				if (!added && first->second.second != m) {
+					Log(LL::Warn) << "Sub '" << sub.name << "' in " << modules[m].name << " was already declared in " << modules[first->second.second].name
+						<< ". Calls will go to the first one.";
+				}
+				subs.push_back({ &modules[m], &sub, std::span(modules[m].code).subspan(sub.start, sub.size) });
+			}
+		}
+
+		u32 entryFuncId = static_cast<u32>(-1);
+		if (auto entry = subByName.find(entrySubName); entry == subByName.end()) {
+			Log(LL::Warn) << "Entry sub '" << entrySubName << " was not found. Code will compile but will not run.";
+		} else {
+			entryFuncId = entry->second.first;
+		}
+
+		bool hadError = false;
+		u32 firstId = 0;
+		for (ObjectModule const& module : modules) {
+			for (ObjectModule::Relocation const& reloc : module.relocations) {
+				std::string const& name = module.symbols[reloc.symbol];
+				auto callee = subByName.find(name);
+				if (callee == subByName.end()) {
+					Log(LL::Error) << "[" << (module.name.empty() ? "" : module.name + " ") << "line " << reloc.line << "] Error at '" << name << "': Unknown instruction or sub.";
+					hadError = true;
+					continue;
+				}
+				subs[firstId + reloc.sub].calls.emplace_back(reloc.pos, callee->second.first);
+			}
+			firstId += static_cast<u32>(module.subs.size());
+		}
+		if (hadError) return {};
+
+		bool dynamicCalls = false;
+		for (LinkSub& sub : subs) {
+			std::ranges::sort(sub.calls);
+			scanSub(sub);
+			dynamicCalls |= sub.dynamicCall;
+		}
+
+		const u32 subCount = static_cast<u32>(subs.size());
+		bool strip = options.stripUnreachableSubs && entryFuncId != static_cast<u32>(-1);
+		bool merge = options.mergeIdenticalSubs;
+		if (dynamicCalls && (strip || merge)) {
+			Log(LL::Debug) << "Subs were not stripped or merged because some calls go to ids only known at runtime.";
+			strip = merge = false;
+		}
+
+		// subs up to the highest id FINTERP may start keep their ids, so everything before it has to stay where it is.
+		u32 pinned = 0;
+		std::vector<bool> reachable(subCount, !strip);
+		if (strip) {
+			std::vector<u32> todo;
+			auto reach = [&](u32 id) {
+				if (reachable[id]) return;
+				reachable[id] = true;
+				todo.push_back(id);
+			};
+			reach(entryFuncId);
+			while (!todo.empty()) {
+				LinkSub const& sub = subs[todo.back()];
+				todo.pop_back();
+				for (auto [pos, callee] : sub.calls) reach(callee);
+				if (sub.interps) {
+					u32 highest = min(static_cast<u32>(std::bit_width(sub.interps)), subCount);
+					for (; pinned < highest; pinned++) reach(pinned);
+				}
+			}
+		} else {
+			u32 interps = 0;
+			for (LinkSub const& sub : subs) interps |= sub.interps;
+			pinned = min(static_cast<u32>(std::bit_width(interps)), subCount);
+		}
+
+		std::vector<u32> classes;
+		if (merge) classes = identicalClasses(subs);
+
+		// the subs that make it into the code, by new id.
+		std::vector<u32> kept;
+		std::vector<u32> ids(subCount, static_cast<u32>(-1));
+		// new id of the first kept sub of each class.
+		std::unordered_map<u32, u32> classIds;
+		u32 merged = 0;
+		for (u32 i = 0; i < subCount; i++) {
+			if (!reachable[i]) continue;
+			if (merge) {
+				auto [first, added] = classIds.try_emplace(classes[i], static_cast<u32>(kept.size()));
+				if (!added && i >= pinned) {
+					ids[i] = first->second;
+					merged++;
+					continue;
+				}
+			}
+			ids[i] = static_cast<u32>(kept.size());
+			kept.push_back(i);
+		}
+		if (kept.size() != subCount) {
+			Log(LL::Debug) << "Stripped " << subCount - kept.size() - merged << " unreachable subs and merged " << merged << " identical subs, "
+				<< kept.size() << " of " << subCount << " are left.";
+		}
+
+		usize codeSize = 0;
+		for (u32 i : kept) codeSize += subs[i].code.size();
+
+		const u32 headerSize = static_cast<u32>(kept.size()) * 3 + 2;
+		std::vector<i32> code;
+		code.reserve(headerSize + codeSize);
+		code.resize(headerSize);
+		code[0] = static_cast<i32>(kept.size());
+		code[1] = entryFuncId == static_cast<u32>(-1) ? entryFuncId : ids[entryFuncId];
+
+		for (u32 id = 0; id < kept.size(); id++) {
+			LinkSub const& sub = subs[kept[id]];
+			const u32 start = static_cast<u32>(code.size());
+			code[id * 3 + 2] = sub.def->type;
+			code[id * 3 + 3] = static_cast<i32>(sub.code.size());
+			code[id * 3 + 4] = start;
+			code.insert(code.end(), sub.code.begin(), sub.code.end());
+			for (auto [pos, callee] : sub.calls) code[start + pos] = ids[callee];
+		}
+
+		if (newIds) *newIds = std::move(ids);
+		return code;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "ZDriveCompiler.hpp"
+
+#include "passes.hpp"
+
+#include <cmath>
+
+namespace ZDrive::Compiler {
+	namespace {
+		bool isClock(Arg const& arg) { return arg.type == AT::VTREF && arg.val.u == VTID::CLOCK; }
+
+		// reading the arg changes something, or might log an error that removing it would hide.
+		bool readHasEffects(Arg const& arg) {
+			if (arg.type != AT::VTREF) return false;
+			return (arg.val.u >= VTID::RAND && arg.val.u <= VTID::RANDRAD) || ValPtr(arg.val.u).b;
+		}
+
+		bool anyReadHasEffects(Ins const& ins, usize from = 0) {
+			for (usize i = from; i < ins.args.size(); i++) if (readHasEffects(ins.args[i])) return true;
+			return false;
+		}
+
+		bool allConst(Ins const& ins, usize from) {
+			for (usize i = from; i < ins.args.size(); i++) if (ins.args[i].type != AT::CNST) return false;
+			return true;
+		}
+
+		// a plain variable of this routine that nothing else cares about the order of writes to.
+		bool isLocalVar(Arg const& arg) {
+			return arg.type == AT::CNST && !isSpecialVar(arg.val.u) && !ValPtr(arg.val.u).b;
+		}
+
+		void replace(IRIns& i, u32 opcode, std::vector<Arg> args) {
+			i.ins.header.ins = opcode;
+			i.ins.header.arg_count = static_cast<u32>(args.size());
+			i.ins.args = std::move(args);
+		}
+
+		u32 nextLive(IRSub const& ir, u32 i) {
+			do i++; while (i < ir.code.size() && ir.code[i].removed);
+			return i;
+		}
+
+		bool isIntJump(u32 opcode) {
+			switch (opcode) {
+			case INS::JMP_EQU: case INS::JMP_NEQ: case INS::JMP_LT:
+			case INS::JMP_LTE: case INS::JMP_GT: case INS::JMP_GTE:
+				return true;
+			default: return false;
+			}
+		}
+
+		// how many args the VM reads for a jmp or conditional jump, anything less throws.
+		usize jumpArgCount(u32 opcode) {
+			if (opcode != INS::JMP && !(opcode >= INS::JMP_EQU && opcode <= INS::JMP_GTE_F)) return 0;
+			return GetOp(opcode)->arity;
+		}
+
+		// mirrors RoutineBase::Handle. Transcendentals are left alone since libm may not agree with the one the game ships with.
+		std::optional<Value> foldValue(Ins const& ins) {
+			std::vector<Arg> const& a = ins.args;
+			switch (ins.header.ins) {
+			case INS::ISET: {
+				if (a.size() < 2) return std::nullopt;
+				f32 f = a[1].val.f;
+				if (!(f >= -2147483648.0f && f < 2147483648.0f)) return std::nullopt;
+				return static_cast<i32>(f);
+			}
+			case INS::FSET: if (a.size() < 2) return std::nullopt; return static_cast<f32>(a[1].val.s);
+			default: break;
+			}
+
+			if (a.size() < 3) return std::nullopt;
+			return foldBinary(ins.header.ins, a[1].val, a[2].val);
+		}
+
+		bool jumpTaken(u32 opcode, Value a, Value b) {
+			switch (opcode) {
+			case INS::JMP_EQU: return a == b;
+			case INS::JMP_NEQ: return a != b;
+			case INS::JMP_LT: return a.s < b.s;
+			case INS::JMP_LTE: return a.s <= b.s;
+			case INS::JMP_GT: return a.s > b.s;
+			case INS::JMP_GTE: return a.s >= b.s;
+			default: return false;
+			}
+		}
+
+		// the least CLOCK can be right after instruction i jumps, if it can be known.
+		std::optional<i32> clockAfterJump(IRIns const& i) {
+			Arg const& t = i.ins.args[jumpArg(i.ins.header.ins).value() + 1];
+			if (t.type == AT::CNST) return t.val.s;
+			// it ran, so CLOCK was at least its time.
+			if (isClock(t)) return i.ins.header.time;
+			return std::nullopt;
+		}
+	}
+
+	std::optional<Value> foldBinary(u32 opcode, Value x, Value y) {
+		switch (opcode) {
+		// done unsigned so overflow wraps like it does at runtime instead of being UB here.
+		case INS::ISET_ADD: return x.u + y.u;
+		case INS::ISET_SUB: return x.u - y.u;
+		case INS::ISET_MUL: return x.u * y.u;
+		case INS::ISET_DIV:
+		case INS::ISET_MOD:
+			if (y.s == 0 || (x.s == INT32_MIN && y.s == -1)) return std::nullopt;
+			return opcode == INS::ISET_DIV ? x.s / y.s : x.s % y.s;
+		case INS::FSET_ADD: return x.f + y.f;
+		case INS::FSET_SUB: return x.f - y.f;
+		case INS::FSET_MUL: return x.f * y.f;
+		case INS::FSET_DIV: return x.f / y.f;
+		case INS::FSET_MOD: return fmodf(x.f, y.f);
+		default: return std::nullopt;
+		}
+	}
+
+	u32 foldConstants(IRSub& ir) {
+		u32 folded = 0;
+		for (u32 i = 0; i < ir.code.size(); i++) {
+			IRIns& cur = ir.code[i];
+			Ins const& ins = cur.ins;
+			if (ins.args.empty()) continue;
+
+			if (auto val = allConst(ins, 1) ? foldValue(ins) : std::nullopt) {
+				replace(cur, INS::SET, { ins.args[0], {AT::CNST, val.value()} });
+				folded++;
+				continue;
+			}
+
+			if (!isIntJump(ins.header.ins) || ins.args.size() < 4 || !cur.target) continue;
+			// args[1] is when to jump to, which a JMP reads too.
+			if (!allConst(ins, 2)) continue;
+			if (jumpTaken(ins.header.ins, ins.args[2].val, ins.args[3].val)) {
+				replace(cur, INS::JMP, { ins.args[0], ins.args[1] });
+			} else if (readHasEffects(ins.args[1])) {
+				continue;
+			} else if (ir.canRemove(i)) {
+				cur.removed = true;
+			} else {
+				// still has to wait for its time.
+				replace(cur, INS::NOP, {});
+				cur.target.reset();
+			}
+			folded++;
+		}
+		ir.compact();
+		return folded;
+	}
+
+	// DIFF and RANK are assumed to exist, otherwise masks are ignored and these would run.
+	u32 removeMaskedOut(IRSub& ir) {
+		u32 removed = 0;
+		for (u32 i = 0; i < ir.code.size(); i++) {
+			IRIns& cur = ir.code[i];
+			// masked instructions still read their args.
+			if (cur.ins.header.diff_mask != 0 && cur.ins.header.rank_mask != 0) continue;
+			if (anyReadHasEffects(cur.ins) || !ir.canRemove(i)) continue;
+			cur.removed = true;
+			removed++;
+		}
+		ir.compact();
+		return removed;
+	}
+
+	u32 removeUnreachable(IRSub& ir) {
+		if (ir.code.empty()) return 0;
+		std::vector<bool> reached(ir.code.size() + 1, false);
+		std::vector<u32> work{ 0 };
+		reached[0] = true;
+		auto visit = [&](u32 i) {
+			if (reached[i]) return;
+			reached[i] = true;
+			work.push_back(i);
+		};
+
+		while (!work.empty()) {
+			u32 i = work.back();
+			work.pop_back();
+			if (i >= ir.code.size()) continue;
+			IRIns const& cur = ir.code[i];
+			if (cur.target) visit(cur.target.value());
+			u32 opcode = cur.ins.header.ins;
+			bool neverFallsThrough = (opcode == INS::JMP || opcode == INS::RET) && alwaysRuns(cur.ins.header);
+			if (!neverFallsThrough) visit(i + 1);
+		}
+
+		u32 removed = 0;
+		for (u32 i = 0; i < ir.code.size(); i++) {
+			if (reached[i]) continue;
+			ir.code[i].removed = true;
+			removed++;
+		}
+		ir.compact();
+		return removed;
+	}
+
+	// jumping to a jmp that would run straight away is the same as jumping to where it goes, as long as CLOCK ends up the same.
+	u32 threadJumps(IRSub& ir) {
+		u32 threaded = 0;
+		for (IRIns& cur : ir.code) {
+			if (!cur.target || cur.ins.args.size() < jumpArg(cur.ins.header.ins).value() + 2) continue;
+			bool changed = false;
+			// a cycle of jmps would never end, so give up after visiting every instruction.
+			for (usize hops = 0; hops < ir.code.size(); hops++) {
+				u32 t = cur.target.value();
+				if (t >= ir.code.size() || &ir.code[t] == &cur) break;
+				IRIns const& next = ir.code[t];
+				if (next.ins.header.ins != INS::JMP || next.ins.args.size() != 2 || !alwaysRuns(next.ins.header)) break;
+
+				Arg& curT = cur.ins.args[jumpArg(cur.ins.header.ins).value() + 1];
+				Arg const& nextT = next.ins.args[1];
+				// the jmp has to run the moment it's reached, and whatever it sets CLOCK to has to be known here.
+				auto clock = clockAfterJump(cur);
+				if (!clock || next.ins.header.time > clock.value()) break;
+				if (!isClock(nextT) && nextT.type != AT::CNST) break;
+
+				// a jmp with t = $CLOCK leaves CLOCK as is.
+				if (nextT.type == AT::CNST) curT = nextT;
+				cur.target = next.target;
+				changed = true;
+			}
+			if (changed) threaded++;
+		}
+		return threaded;
+	}
+
+	u32 removeRedundantSets(IRSub& ir) {
+		std::vector<bool> targets = ir.isTarget();
+		u32 removed = 0;
+		for (u32 i = 0; i < ir.code.size(); i++) {
+			IRIns& cur = ir.code[i];
+			Ins const& ins = cur.ins;
+			if (ins.header.ins != INS::SET || ins.args.size() != 2 || !isLocalVar(ins.args[0])) continue;
+			u32 x = ins.args[0].val.u;
+
+			// set(x, $x)
+			if (ins.args[1].type == AT::VTREF && ins.args[1].val.u == x && ir.canRemove(i)) {
+				cur.removed = true;
+				removed++;
+				continue;
+			}
+
+			// set(x, a), set(x, b) where b doesn't read x
+			u32 j = nextLive(ir, i);
+			if (j >= ir.code.size() || targets[j] || readHasEffects(ins.args[1])) continue;
+			Ins const& next = ir.code[j].ins;
+			if (next.header.ins != INS::SET || next.args.size() != 2 || !sameHeader(ins.header, next.header)) continue;
+			if (next.args[0].type != AT::CNST || next.args[0].val.u != x) continue;
+			if (next.args[1].type == AT::VTREF && next.args[1].val.u == x) continue;
+			cur.removed = true;
+			removed++;
+		}
+		ir.compact();
+		return removed;
+	}
+
+	// the compiler ends every if block with a jmp over the else, which is the next instruction when there is no else.
+	u32 removeJumpsToNext(IRSub& ir) {
+		u32 removed = 0;
+		for (u32 i = 0; i < ir.code.size(); i++) {
+			IRIns& cur = ir.code[i];
+			usize argc = jumpArgCount(cur.ins.header.ins);
+			if (!argc || cur.ins.args.size() < argc || cur.target != nextLive(ir, i)) continue;
+			if (!isClock(cur.ins.args[1]) || anyReadHasEffects(cur.ins) || !ir.canRemove(i)) continue;
+			cur.removed = true;
+			removed++;
+		}
+		ir.compact();
+		return removed;
+	}
+
+	void optimize(Sub& sub, u32 writePos, CompileOptions const& options, OptimizationStats& stats) {
+		std::span<i32> arena(*sub.arena);
+		std::optional<IRSub> ir;
+		if (options.foldConstants || options.eliminateDeadCode || options.threadJumps || options.removeRedundantSets
+			|| options.layoutBlocks || options.fuseSuperinstructions) {
+			ir = IRSub::lift(sub);
+			if (!ir) stats.skippedSubs++;
+		}
+
+		if (ir) {
+			if (options.foldConstants) stats.folded += foldConstants(*ir);
+			if (options.eliminateDeadCode) stats.maskedOut += removeMaskedOut(*ir);
+			if (options.threadJumps) stats.threaded += threadJumps(*ir);
+			// after threading, since that can leave jmps nothing goes to anymore.
+			if (options.eliminateDeadCode) stats.unreachable += removeUnreachable(*ir);
+			if (options.removeRedundantSets) stats.redundantSets += removeRedundantSets(*ir);
+			if (options.layoutBlocks) stats.jumpsToNext += removeJumpsToNext(*ir);
+			if (options.fuseSuperinstructions) fuseSuperinstructions(*ir, stats.fusion);
+		}
+
+		// every pass replaces instructions with ones at most as big, so the result always fits where the sub was.
+		if (ir && ir->size() <= sub.size()) {
+			u32 size = ir->size();
+			ir->lower(arena.subspan(writePos, size));
+			sub.length = size;
+		} else {
+			std::copy(arena.begin() + sub.start, arena.begin() + sub.start + sub.size(), arena.begin() + writePos);
+		}
+		sub.start = writePos;
+	}
+}
\ No newline at end of file
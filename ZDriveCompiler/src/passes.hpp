@@ -0,0 +1,38 @@
+#pragma once
+
+#include "ZDriveCompiler.hpp"
+
+#include "defs.hpp"
+#include "ir.hpp"
+#include "peephole.hpp"
+
+namespace ZDrive::Compiler {
+	struct OptimizationStats {
+		// instructions replaced by a SET or JMP, or dropped because they never jump.
+		u32 folded = 0;
+		// instructions whose masks are 0.
+		u32 maskedOut = 0;
+		u32 unreachable = 0;
+		// jumps retargeted past an unconditional jump.
+		u32 threaded = 0;
+		u32 redundantSets = 0;
+		u32 jumpsToNext = 0;
+		PeepholeStats fusion;
+		// subs left as is because they couldn't be lifted, see IRSub::lift.
+		u32 skippedSubs = 0;
+	};
+
+	// what a three operand *SET_* instruction would write, if that can be known without running it.
+	std::optional<Value> foldBinary(u32 opcode, Value x, Value y);
+
+	u32 foldConstants(IRSub& ir);
+	u32 removeMaskedOut(IRSub& ir);
+	u32 removeUnreachable(IRSub& ir);
+	u32 threadJumps(IRSub& ir);
+	u32 removeRedundantSets(IRSub& ir);
+	u32 removeJumpsToNext(IRSub& ir);
+
+	// runs the passes enabled in options on a sub, then moves its code down to writePos in its arena, which must not be after where it is now.
+	// Must run after labels are resolved.
+	void optimize(Sub& sub, u32 writePos, CompileOptions const& options, OptimizationStats& stats);
+}
\ No newline at end of file
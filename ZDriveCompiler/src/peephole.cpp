@@ -0,0 +1,131 @@
+#include "ZDriveCompiler.hpp"
+
+#include "peephole.hpp"
+
+
+namespace ZDrive::Compiler {
+	namespace {
+		bool isConst(Arg const& arg, u32 val) { return arg.type == AT::CNST && arg.val.u == val; }
+		bool isRef(Arg const& arg, u32 id) { return arg.type == AT::VTREF && arg.val.u == id; }
+
+		bool isIntJump(u32 opcode) {
+			switch (opcode) {
+			case INS::JMP_EQU: case INS::JMP_NEQ: case INS::JMP_LT:
+			case INS::JMP_LTE: case INS::JMP_GT: case INS::JMP_GTE:
+				return true;
+			default: return false;
+			}
+		}
+
+		// set OUT0..OUTn, call -> call_args(sub, values...)
+		// the values are all read before any OUT is written, so none of them may read an OUT.
+		u32 matchCallArgs(std::vector<IRIns> const& code, u32 i, std::vector<bool> const& targets, IRIns& fused) {
+			u32 n = 0;
+			while (i + n < code.size() && n < 8) {
+				Ins const& set = code[i + n].ins;
+				if (set.header.ins != INS::SET || set.args.size() != 2 || !isConst(set.args[0], VTID::OUT0 + n)) break;
+				Arg const& val = set.args[1];
+				if (val.type == AT::VTREF && val.val.u >= VTID::OUT0 && val.val.u <= VTID::OUT7) break;
+				n++;
+			}
+			if (n == 0 || i + n >= code.size()) return 0;
+
+			Ins const& call = code[i + n].ins;
+			if (call.header.ins != INS::CALL || call.args.size() != 1) return 0;
+			for (u32 j = 1; j <= n; j++) {
+				if (targets[i + j] || !sameHeader(code[i + j].ins.header, code[i].ins.header)) return 0;
+			}
+
+			fused.ins = Ins({ call.header.time, call.header.diff_mask, call.header.rank_mask, INS::CALL_ARGS, n + 1 }, { call.args[0] });
+			for (u32 j = 0; j < n; j++) fused.ins.args.push_back(code[i + j].ins.args[1]);
+			return n + 1;
+		}
+
+		// idec(x), jmp_cc(pos, t, $x, rhs) -> dec_jmp(x, cc, pos, t, rhs)
+		u32 matchDecJmp(std::vector<IRIns> const& code, u32 i, std::vector<bool> const& targets, IRIns& fused) {
+			if (i + 1 >= code.size() || targets[i + 1]) return 0;
+			Ins const& dec = code[i].ins;
+			Ins const& jmp = code[i + 1].ins;
+			if (dec.header.ins != INS::IDEC || dec.args.size() != 1 || dec.args[0].type != AT::CNST) return 0;
+			if (!isIntJump(jmp.header.ins) || jmp.args.size() < 4 || !sameHeader(dec.header, jmp.header)) return 0;
+
+			u32 x = dec.args[0].val.u;
+			if (isSpecialVar(x) || ValPtr(x).b) return 0;
+			if (!code[i + 1].target || isRef(jmp.args[1], x) || !isRef(jmp.args[2], x) || isRef(jmp.args[3], x)) return 0;
+			// the int jumps ignore anything after rhs, but it still has to be safe to not read it.
+			for (usize j = 4; j < jmp.args.size(); j++) if (jmp.args[j].type != AT::CNST) return 0;
+
+			fused.ins = Ins({ dec.header.time, dec.header.diff_mask, dec.header.rank_mask, INS::DEC_JMP, 5 },
+				{ dec.args[0], {AT::CNST, jmp.header.ins}, jmp.args[0], jmp.args[1], jmp.args[3] });
+			fused.target = code[i + 1].target;
+			return 2;
+		}
+
+		// mathCirclePos(tx, ty, r, theta), fadd(px, $tx), fadd(py, $ty) -> circlepos_add(tx, ty, r, theta, px, py)
+		u32 matchCirclePosAdd(std::vector<IRIns> const& code, u32 i, std::vector<bool> const& targets, IRIns& fused) {
+			if (i + 2 >= code.size() || targets[i + 1] || targets[i + 2]) return 0;
+			Ins const& circle = code[i].ins;
+			Ins const& addX = code[i + 1].ins;
+			Ins const& addY = code[i + 2].ins;
+			if (circle.header.ins != INS::MATHCIRCLEPOS || circle.args.size() != 4) return 0;
+			if (addX.header.ins != INS::FADD || addX.args.size() != 2 || addY.header.ins != INS::FADD || addY.args.size() != 2) return 0;
+			if (!sameHeader(circle.header, addX.header) || !sameHeader(circle.header, addY.header)) return 0;
+
+			Arg const* dests[] = { &circle.args[0], &circle.args[1], &addX.args[0], &addY.args[0] };
+			for (Arg const* dest : dests) {
+				if (dest->type != AT::CNST || isSpecialVar(dest->val.u)) return 0;
+			}
+			if (!isRef(addX.args[1], circle.args[0].val.u) || !isRef(addY.args[1], circle.args[1].val.u)) return 0;
+
+			fused.ins = Ins({ circle.header.time, circle.header.diff_mask, circle.header.rank_mask, INS::CIRCLEPOS_ADD, 6 },
+				{ circle.args[0], circle.args[1], circle.args[2], circle.args[3], addX.args[0], addY.args[0] });
+			return 3;
+		}
+	}
+
+	void fuseSuperinstructions(IRSub& ir, PeepholeStats& stats) {
+		std::vector<bool> targets = ir.isTarget();
+		for (u32 i = 0; i < ir.code.size(); ) {
+			IRIns fused;
+			u32 consumed = 0;
+			if ((consumed = matchCallArgs(ir.code, i, targets, fused)) != 0) stats.callArgs++;
+			else if ((consumed = matchDecJmp(ir.code, i, targets, fused)) != 0) stats.decJmp++;
+			else if ((consumed = matchCirclePosAdd(ir.code, i, targets, fused)) != 0) stats.circlePosAdd++;
+
+			if (!consumed) {
+				i++;
+				continue;
+			}
+			// the fused instruction takes the first one's place, so jumps to the sequence still land on it.
+			ir.code[i] = std::move(fused);
+			for (u32 j = 1; j < consumed; j++) ir.code[i + j].removed = true;
+			stats.removed += consumed - 1;
+			i += consumed;
+		}
+		ir.compact();
+	}
+
+	void MineSequences(std::vector<i32> const& code, u32 length, std::map<std::vector<u32>, u32>& counts) {
+		if (length == 0 || code.size() < 2 || code.size() < 2 + static_cast<usize>(code[0]) * 3) return;
+
+		u32 rt_count = code[0];
+		for (u32 i = 0; i < rt_count; i++) {
+			u32 size = code[i * 3 + 3];
+			u32 start = code[i * 3 + 4];
+			if (static_cast<usize>(start) + size > code.size()) continue;
+
+			auto ir = IRSub::lift(std::span(code.begin() + start, size));
+			if (!ir) continue;
+			std::vector<bool> targets = ir->isTarget();
+
+			for (usize first = 0; first + length <= ir->code.size(); first++) {
+				std::vector<u32> seq{ ir->code[first].ins.header.ins };
+				for (usize j = first + 1; j < first + length; j++) {
+					if (targets[j] || !sameHeader(ir->code[j].ins.header, ir->code[first].ins.header)) break;
+					seq.push_back(ir->code[j].ins.header.ins);
+				}
+				if (seq.size() == length) counts[seq]++;
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ZDriveCompiler.hpp"
+
+#include "defs.hpp"
+#include "ir.hpp"
+
+namespace ZDrive::Compiler {
+	struct PeepholeStats {
+		u32 callArgs = 0;
+		u32 decJmp = 0;
+		u32 circlePosAdd = 0;
+		// how many instructions the fusions removed in total.
+		u32 removed = 0;
+	};
+
+	// fuses common instruction sequences into superinstructions. Sequences that are jumped into partway are left alone.
+	void fuseSuperinstructions(IRSub& ir, PeepholeStats& stats);
+}
\ No newline at end of file
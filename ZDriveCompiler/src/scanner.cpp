@@ -2,6 +2,8 @@
 
 #include "scanner.hpp"
 
+#include <cstring>
+
 namespace ZDrive::Compiler {
 	Token Scanner::ScanToken() {
 		skipWhitespace();
@@ -12,10 +14,10 @@ namespace ZDrive::Compiler {
 		char c = advance();
 		char n = peek();
 
-		if (c == 'r' && std::isdigit(n)) return rankspec();
-		if (c == 'd' && std::isdigit(n)) return diffspec();
+		if (c == 'r' && isdigit(n)) return rankspec();
+		if (c == 'd' && isdigit(n)) return diffspec();
 		if (isalpha(c)) return identifier();
-		if (std::isdigit(c) || (c == '-' && std::isdigit(n))) return number();
+		if (isdigit(c) || (c == '-' && isdigit(n))) return number();
 		if (c == '$' && isalnum(n)) return vartableid();
 
 		switch (c) {
@@ -49,19 +51,19 @@ namespace ZDrive::Compiler {
 
 
 	Token Scanner::makeToken(TokenType type) const {
-		return Token{ type, source.substr(start, current - start), line };
+		return Token{ type, std::string_view(source).substr(start, current - start), line };
 	}
 
-	Token Scanner::errorToken(std::string msg) const {
-		return Token{ TOKEN::ERR, std::move(msg), line };
+	Token Scanner::errorToken(char const* msg) const {
+		return Token{ TOKEN::ERR, msg, line };
 	}
 
 	Token Scanner::number() {
 		if (peek() == '-') advance();
-		while (std::isdigit(peek())) advance();
-		if (peek() == '.' && std::isdigit(peekNext())) {
+		while (isdigit(peek())) advance();
+		if (peek() == '.' && isdigit(peekNext())) {
 			advance();
-			while (std::isdigit(peek())) advance();
+			while (isdigit(peek())) advance();
 			return makeToken(TOKEN::FLOAT);
 		}
 		return makeToken(TOKEN::INT);
@@ -69,33 +71,42 @@ namespace ZDrive::Compiler {
 
 	Token Scanner::identifier() {
 		while (isalnum(peek())) advance();
-		return makeToken(identifierType());
+		Token token = makeToken(identifierType());
+		if (token.type == TOKEN::IDENTIFIER) token.sym = names.intern(token.str);
+		return token;
 	}
 
 	Token Scanner::vartableid() {
 		while (isalnum(peek())) advance();
-		return makeToken(TOKEN::VTID);
+		Token token = makeToken(TOKEN::VTID);
+		// $name, which gets resolved like an identifier.
+		if (isalpha(token.str[1])) token.sym = names.intern(token.str.substr(1));
+		return token;
 	}
 
 	Token Scanner::atSym() {
 		char c = peek();
 		if (isalpha(c)) {
 			while (isalnum(peek())) advance();
-			return makeToken(TOKEN::LABEL);
-		} else if (c == '+' || c == '-' || std::isdigit(c)) {
-			while (std::isdigit(peek())) advance();
+			Token token = makeToken(TOKEN::LABEL);
+			token.sym = names.intern(token.str.substr(1));
+			return token;
+		} else if (c == '+' || c == '-' || isdigit(c)) {
+			// the sign is part of it, for timestamps relative to the last one.
+			if (!isdigit(c)) advance();
+			while (isdigit(peek())) advance();
 			return makeToken(TOKEN::TIMESTAMP);
 		}
 		return makeToken(TOKEN::ERR);
 	}
 
 	Token Scanner::rankspec() {
-		while (std::isdigit(peek())) advance();
+		while (isdigit(peek())) advance();
 		return makeToken(TOKEN::RANK);
 	}
 
 	Token Scanner::diffspec() {
-		while (std::isdigit(peek())) advance();
+		while (isdigit(peek())) advance();
 		return makeToken(TOKEN::DIFF);
 	}
 
@@ -114,6 +125,13 @@ namespace ZDrive::Compiler {
 		case 'l': return checkKeyword(1, 3, "oop", TOKEN::LOOP);
 			/*case 'o': return checkKeyword(1, 1, "r", TOKEN::OR);*/
 		case 's': return checkKeyword(1, 2, "ub", TOKEN::SUB);
+		case 'u':
+		{
+			i32 len = current - start;
+			if (len == 5) return checkKeyword(1, 4, "ntil", TOKEN::UNTIL);
+			if (len == 7) return checkKeyword(1, 6, "ntil_f", TOKEN::UNTIL_F);
+			break;
+		}
 		case 'w':
 		{
 			i32 len = current - start;
@@ -124,10 +142,10 @@ namespace ZDrive::Compiler {
 		return TOKEN::IDENTIFIER;
 	}
 
-	TokenType Scanner::checkKeyword(u32 _start, u32 _length, std::string const& rest, TokenType type) const {
+	TokenType Scanner::checkKeyword(u32 _start, u32 _length, std::string_view rest, TokenType type) const {
 		return (
 			current - start == _start + _length &&
-			source.substr(start + _start, _length) == rest
+			std::string_view(source).substr(start + _start, _length) == rest
 			) ? type : TOKEN::IDENTIFIER;
 	}
 
@@ -154,20 +172,19 @@ namespace ZDrive::Compiler {
 	}
 
 	void Scanner::skipWhitespace() {
+		char const* src = source.data();
 		for (;;) {
-			char c = peek();
-			switch (c) {
-			case '\n': line++; __fallthrough;
-			case ' ':
-			case '\r':
-			case '\t': advance(); break;
-			case '/':
-				if (peekNext() == '/') {
-					while (peek() != '\n' && !isAtEnd()) advance();
-				} else return;
-				break;
-			default: return;
-			}
+			char c = src[current];
+			if (c == '\n') {
+				line++;
+				current++;
+			} else if (is(c, SPACE)) {
+				current++;
+			} else if (c == '/' && src[current + 1] == '/') {
+				// the newline ending it is handled above so the line gets counted.
+				void const* end = memchr(src + current, '\n', source.size() - current);
+				current = end ? static_cast<u32>(static_cast<char const*>(end) - src) : static_cast<u32>(source.size());
+			} else return;
 		}
 	}
 }
\ No newline at end of file
@@ -2,25 +2,49 @@
 
 #include "ZDriveCompiler.hpp"
 
+#include <array>
+
 #include "defs.hpp"
+#include "interner.hpp"
 
 namespace ZDrive::Compiler {
 	class Scanner {
 	public:
-		Scanner(std::string const& source) : source(source), start(0), current(0), line(1) {}
+		// identifiers are interned into names. Tokens view into source, so it has to outlive them.
+		Scanner(std::string const& source, Interner& names) : source(source), names(names), start(0), current(0), line(1) {}
 
 		Token ScanToken();
+
+		// ascii only, the compiler uses these too when it looks inside a token.
+		inline static bool isdigit(char c) { return is(c, DIGIT); }
+		inline static bool isalpha(char c) { return is(c, ALPHA); }
+		inline static bool isalnum(char c) { return is(c, ALPHA | DIGIT); }
 	private:
 		std::string const& source;
+		Interner& names;
 
 		u32 start;
 		u32 current;
 		u32 line;
 
-		inline static bool isalpha(char c) { return std::isalpha(c) || c == '_'; }
-		inline static bool isalnum(char c) { return std::isalnum(c) || c == '_'; }
+		enum CharClass : u8 {
+			SPACE = 1 << 0,
+			DIGIT = 1 << 1,
+			ALPHA = 1 << 2,
+		};
+		// a table instead of <cctype> since those check the locale, and are UB for negative chars.
+		static constexpr std::array<u8, 256> charClasses = []() {
+			std::array<u8, 256> ret{};
+			for (char c : std::string_view(" \r\t")) ret[static_cast<u8>(c)] |= SPACE;
+			for (u32 c = '0'; c <= '9'; c++) ret[c] |= DIGIT;
+			for (u32 c = 'a'; c <= 'z'; c++) ret[c] |= ALPHA;
+			for (u32 c = 'A'; c <= 'Z'; c++) ret[c] |= ALPHA;
+			ret['_'] |= ALPHA;
+			return ret;
+		}();
+		inline static bool is(char c, u8 classes) { return charClasses[static_cast<u8>(c)] & classes; }
 		Token makeToken(TokenType type) const;
-		Token errorToken(std::string msg) const;
+		Token errorToken(char const* msg) const;
 		Token number();
 		Token identifier();
 		Token vartableid();
@@ -28,7 +52,7 @@ namespace ZDrive::Compiler {
 		Token rankspec();
 		Token diffspec();
 		TokenType identifierType() const;
-		TokenType checkKeyword(u32 start, u32 length, std::string const& rest, TokenType type) const;
+		TokenType checkKeyword(u32 start, u32 length, std::string_view rest, TokenType type) const;
 		char peek() const;
 		char peekNext() const;
 		char advance();
@@ -0,0 +1,53 @@
+#include "ZDriveCompiler.hpp"
+
+#include "symbols.hpp"
+
+namespace ZDrive::Compiler {
+	std::optional<Token> const& SymbolTable::binding(u32 sym) {
+		return at(sym).binding;
+	}
+
+	void SymbolTable::bind(u32 sym, Token value) {
+		Entry& entry = at(sym);
+		if (!shadowed.empty()) shadowed.back().emplace_back(sym, entry.binding);
+		entry.binding = value;
+	}
+
+	std::optional<u32> SymbolTable::sub(u32 sym) {
+		return at(sym).sub;
+	}
+
+	bool SymbolTable::declareSub(u32 sym, u32 index) {
+		Entry& entry = at(sym);
+		if (entry.sub) return false;
+		entry.sub = index;
+		return true;
+	}
+
+	std::optional<InsDecl> const& SymbolTable::ins(u32 sym) {
+		Entry& entry = at(sym);
+		if (!entry.insLookedUp) {
+			if (auto decl = lang.get(names.name(sym))) entry.ins = decl.value().get();
+			entry.insLookedUp = true;
+		}
+		return entry.ins;
+	}
+
+	void SymbolTable::pushScope() {
+		shadowed.emplace_back();
+	}
+
+	void SymbolTable::popScope() {
+		if (shadowed.empty()) return;
+		// backwards, so binding the same name twice in one scope still restores the outer binding.
+		auto& scope = shadowed.back();
+		for (auto it = scope.rbegin(); it != scope.rend(); it++) entries[it->first].binding = it->second;
+		shadowed.pop_back();
+	}
+
+	SymbolTable::Entry& SymbolTable::at(u32 sym) {
+		// the interner hands out ids as it sees new names, so grow to fit all of them at once.
+		if (sym >= entries.size()) entries.resize(names.size());
+		return entries[sym];
+	}
+}
\ No newline at end of file
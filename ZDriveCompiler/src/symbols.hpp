@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ZDriveCompiler.hpp"
+
+#include "defs.hpp"
+#include "interner.hpp"
+
+namespace ZDrive::Compiler {
+	// what every name means at the current point in the source, indexed by interned id so resolving a name is one array access.
+	// bindings are scoped: ones made inside a sub are undone when it ends. Subs and instructions are always global.
+	class SymbolTable {
+	public:
+		SymbolTable(Interner& names, LangDecl const& lang) : names(names), lang(lang) {}
+
+		std::optional<Token> const& binding(u32 sym);
+		void bind(u32 sym, Token value);
+
+		// index into _Compiler::subs.
+		std::optional<u32> sub(u32 sym);
+		// returns false if a sub with that name already exists, in which case the first one keeps the name.
+		bool declareSub(u32 sym, u32 index);
+
+		std::optional<InsDecl> const& ins(u32 sym);
+
+		void pushScope();
+		void popScope();
+	private:
+		struct Entry {
+			std::optional<Token> binding;
+			std::optional<u32> sub;
+			// looked up in lang the first time the name is used as one, so only names actually used get copied.
+			bool insLookedUp = false;
+			std::optional<InsDecl> ins;
+		};
+
+		Interner& names;
+		LangDecl const& lang;
+		std::vector<Entry> entries;
+		// for each open scope, the bindings it replaced, to put back when it closes.
+		std::vector<std::vector<std::pair<u32, std::optional<Token>>>> shadowed;
+
+		Entry& at(u32 sym);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "ZDriveCompiler.hpp"
+
+namespace ZDrive::Compiler {
+	namespace {
+		// how an opcode is lowered. a0, a1, ... are its args, already resolved in order (so RAND is drawn the same number of times).
+		// bodies that set 'ok' get checked afterwards, like a HandleResult's success.
+		// how many args it reads and whether it can change nextPtr come from the op table.
+		struct NativeOp {
+			char const* body;
+		};
+
+		// these mirror RoutineBase::Handle. Anything not in here runs through the interpreter.
+		std::optional<NativeOp> nativeOp(u32 opcode) {
+			switch (opcode) {
+			case INS::NOP: return NativeOp{ "" };
+			case INS::RET: return NativeOp{ "rt.deleteMe = true;\n" };
+			case INS::WAIT: return NativeOp{ "rt.Clock().s -= a0.s;\n" };
+			case INS::JMP: return NativeOp{ "rt.Jump(a0, a1);\n" };
+			case INS::LOOP: return NativeOp{ "ok = rt.Loop(a0, a1, a2);\n" };
+			case INS::SET: return NativeOp{ "ok = rt.Set(a0, a1);\n" };
+			case INS::ISET: return NativeOp{ "ok = rt.Set(a0, static_cast<i32>(a1.f));\n" };
+			case INS::FSET: return NativeOp{ "ok = rt.Set(a0, static_cast<f32>(a1.s));\n" };
+			case INS::IADD: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.s + b.s; });\n" };
+			case INS::ISUB: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.s - b.s; });\n" };
+			case INS::IMUL: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.s * b.s; });\n" };
+			case INS::IDIV: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.s / b.s; });\n" };
+			case INS::IMOD: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.s % b.s; });\n" };
+			case INS::IMOD2: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return b.s % a.s; });\n" };
+			case INS::FADD: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.f + b.f; });\n" };
+			case INS::FSUB: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.f - b.f; });\n" };
+			case INS::FMUL: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.f * b.f; });\n" };
+			case INS::FDIV: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return a.f / b.f; });\n" };
+			case INS::FMOD: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return fmodf(a.f, b.f); });\n" };
+			case INS::FMOD2: return NativeOp{ "ok = rt.SelfOp(a0, a1, [](Value a, Value b) -> Value { return fmodf(b.f, a.f); });\n" };
+			case INS::ISET_ADD: return NativeOp{ "ok = rt.Set(a0, a1.s + a2.s);\n" };
+			case INS::ISET_SUB: return NativeOp{ "ok = rt.Set(a0, a1.s - a2.s);\n" };
+			case INS::ISET_MUL: return NativeOp{ "ok = rt.Set(a0, a1.s * a2.s);\n" };
+			case INS::ISET_DIV: return NativeOp{ "ok = rt.Set(a0, a1.s / a2.s);\n" };
+			case INS::ISET_MOD: return NativeOp{ "ok = rt.Set(a0, a1.s % a2.s);\n" };
+			case INS::FSET_ADD: return NativeOp{ "ok = rt.Set(a0, a1.f + a2.f);\n" };
+			case INS::FSET_SUB: return NativeOp{ "ok = rt.Set(a0, a1.f - a2.f);\n" };
+			case INS::FSET_MUL: return NativeOp{ "ok = rt.Set(a0, a1.f * a2.f);\n" };
+			case INS::FSET_DIV: return NativeOp{ "ok = rt.Set(a0, a1.f / a2.f);\n" };
+			case INS::FSET_MOD: return NativeOp{ "ok = rt.Set(a0, fmodf(a1.f, a2.f));\n" };
+			// same as the interpreter, these step by the bits 1, not 1.0f.
+			case INS::IINC: return NativeOp{ "ok = rt.SelfOp(a0, 1, [](Value a, Value b) -> Value { return a.s + b.s; });\n" };
+			case INS::FINC: return NativeOp{ "ok = rt.SelfOp(a0, 1, [](Value a, Value b) -> Value { return a.f + b.f; });\n" };
+			case INS::IDEC: return NativeOp{ "ok = rt.SelfOp(a0, 1, [](Value a, Value b) -> Value { return a.s - b.s; });\n" };
+			case INS::FDEC: return NativeOp{ "ok = rt.SelfOp(a0, 1, [](Value a, Value b) -> Value { return a.f - b.f; });\n" };
+			case INS::FSET_SIN: return NativeOp{ "ok = rt.Set(a0, Math::sin(a1.f));\n" };
+			case INS::FSET_COS: return NativeOp{ "ok = rt.Set(a0, Math::cos(a1.f));\n" };
+			case INS::FSET_TAN: return NativeOp{ "ok = rt.Set(a0, Math::tan(a1.f));\n" };
+			case INS::FSET_ANGLE: return NativeOp{ "ok = rt.Set(a0, Math::atan2(a2.f - a4.f, a1.f - a3.f));\n" };
+			case INS::NORMRAD: return NativeOp{ "ok = rt.SelfOp(a0, 0, [](Value a, Value) -> Value { return Math::normRad(a.f); });\n" };
+			case INS::MATHCIRCLEPOS: return NativeOp{ "ok &= rt.Set(a0, a2.f * Math::cos(a3.f));\nok &= rt.Set(a1, a2.f * Math::sin(a3.f));\n" };
+			case INS::MATHDISTANCE: return NativeOp{ "f32 dx = a3.f - a1.f;\nf32 dy = a4.f - a2.f;\nok = rt.Set(a0, Math::sqrt(dx * dx + dy * dy));\n" };
+			case INS::V2ADD: return NativeOp{ "ok = rt.Vec2(INS::V2ADD, { a0, a1 });\n" };
+			case INS::V2SCALE: return NativeOp{ "ok = rt.Vec2(INS::V2SCALE, { a0, a1 });\n" };
+			case INS::V2ROTATE: return NativeOp{ "ok = rt.Vec2(INS::V2ROTATE, { a0, a1 });\n" };
+			case INS::V2POLAR_ADD: return NativeOp{ "ok = rt.Vec2(INS::V2POLAR_ADD, { a0, a1, a2 });\n" };
+			case INS::V2NORMALIZE: return NativeOp{ "ok = rt.Vec2(INS::V2NORMALIZE, { a0 });\n" };
+			case INS::V2LENGTH: return NativeOp{ "ok = rt.Vec2(INS::V2LENGTH, { a0, a1 });\n" };
+			case INS::V2DOT: return NativeOp{ "ok = rt.Vec2(INS::V2DOT, { a0, a1, a2 });\n" };
+			case INS::JMP_EQU: return NativeOp{ "if (a2 == a3) rt.Jump(a0, a1);\n" };
+			case INS::JMP_EQU_F: return NativeOp{ "if (fabsf(a2.f - a3.f) < fabsf(a4.f)) rt.Jump(a0, a1);\n" };
+			case INS::JMP_NEQ: return NativeOp{ "if (a2 != a3) rt.Jump(a0, a1);\n" };
+			case INS::JMP_NEQ_F: return NativeOp{ "if (fabsf(a2.f - a3.f) > fabsf(a4.f)) rt.Jump(a0, a1);\n" };
+			case INS::JMP_LT: return NativeOp{ "if (a2.s < a3.s) rt.Jump(a0, a1);\n" };
+			case INS::JMP_LT_F: return NativeOp{ "if (a2.f < a3.f) rt.Jump(a0, a1);\n" };
+			case INS::JMP_LTE: return NativeOp{ "if (a2.s <= a3.s) rt.Jump(a0, a1);\n" };
+			case INS::JMP_LTE_F: return NativeOp{ "if (a2.f <= a3.f + copysignf(a4.f, a3.f)) rt.Jump(a0, a1);\n" };
+			case INS::JMP_GT: return NativeOp{ "if (a2.s > a3.s) rt.Jump(a0, a1);\n" };
+			case INS::JMP_GT_F: return NativeOp{ "if (a2.f > a3.f) rt.Jump(a0, a1);\n" };
+			case INS::JMP_GTE: return NativeOp{ "if (a2.s >= a3.s) rt.Jump(a0, a1);\n" };
+			case INS::JMP_GTE_F: return NativeOp{ "if (a2.f >= a3.f - copysignf(a4.f, a3.f)) rt.Jump(a0, a1);\n" };
+			case INS::YEILD: return NativeOp{ "" };
+			default: return std::nullopt;
+			}
+		}
+
+		// the vars every RoutineBase has. Reading anything else (or anything remote) can fail, which is left to the interpreter to report.
+		bool isBaseLocal(u32 id) {
+			return (id >= VTID::I0 && id <= VTID::RANDRAD) || id == VTID::TIME || id == VTID::CLOCK;
+		}
+
+		std::string literal(i32 val) {
+			return val == INT32_MIN ? "INT32_MIN" : std::to_string(val);
+		}
+
+		void indent(std::string& out, u32 level, std::string_view lines) {
+			while (!lines.empty()) {
+				usize end = lines.find('\n');
+				out.append(level, '\t').append(lines.substr(0, end)).push_back('\n');
+				lines.remove_prefix(end == std::string_view::npos ? lines.size() : end + 1);
+			}
+		}
+
+		// returns the args as C++ declarations, or nullopt if one of them can't be read natively.
+		std::optional<std::string> declareArgs(Ins const& ins) {
+			std::string decl;
+			for (u32 i = 0; i < ins.args.size(); i++) {
+				Arg const& arg = ins.args[i];
+				decl += (i == 0) ? "Value " : ", ";
+				if (arg.type == AT::CNST) decl += std::format("a{} = Value(0x{:x}u)", i, arg.val.u);
+				else if (arg.type == AT::VTREF && isBaseLocal(arg.val.u)) decl += std::format("a{} = rt.Get({})", i, arg.val.u);
+				else return std::nullopt;
+			}
+			if (!decl.empty()) decl += ";\n";
+			return decl;
+		}
+
+		void transpileIns(std::string& out, Ins const& ins, u32 offset, u32 next) {
+			InsHead const& header = ins.header;
+			std::optional<NativeOp> op = nativeOp(header.ins);
+			// with any other number of args the interpreter reads them all, so it runs it.
+			std::optional<std::string> args = op && ins.args.size() == OPS[header.ins].arity ? declareArgs(ins) : std::nullopt;
+
+			indent(out, 3, std::format("case {}: {{ // {}", offset, ins.toString()));
+			indent(out, 4, std::format("if (clock.s < {}) return true;\nrt.Next() = {};", literal(header.time), next));
+
+			if (!args) {
+				indent(out, 4, std::format("if (rt.Interpret({})) {{ rt.Ptr() = rt.Next(); return true; }}", offset));
+				indent(out, 4, std::format("rt.Ptr() = rt.Next();\nif (rt.Ptr() != {}) continue;", next));
+				return;
+			}
+
+			std::string body = op->body;
+			bool checked = body.find("ok") != std::string::npos;
+			if (OPS[header.ins].has(OpFlags::STOPS)) body += std::format("rt.Ptr() = {};\nreturn true;\n", next);
+
+			indent(out, 4, args.value());
+			if (!body.empty()) {
+				indent(out, 4, std::format("if (rt.Runs({}, {})) {{", literal(header.diff_mask), literal(header.rank_mask)));
+				if (checked) indent(out, 5, "bool ok = true;");
+				indent(out, 5, body);
+				if (checked) indent(out, 5, std::format("rt.Check(ok, {});", offset));
+				indent(out, 4, "}");
+			}
+
+			if (OPS[header.ins].has(OpFlags::JUMPS)) indent(out, 4, std::format("rt.Ptr() = rt.Next();\nif (rt.Ptr() != {}) continue;", next));
+			else indent(out, 4, std::format("rt.Ptr() = {};", next));
+		}
+
+		// each instruction is a case of a switch on ptr, so a routine can stop at any of them and resume there next frame.
+		// straight line code falls through from case to case, jumps go back around the loop.
+		void transpileSub(std::string& out, std::span<const i32> code, u32 subId) {
+			indent(out, 1, std::format("bool sub_{}(RoutineNative& rt) {{", subId));
+			indent(out, 2, "Value& clock = rt.Clock();\nfor (;;) {");
+			// a loop that never waits would otherwise go around here forever.
+			indent(out, 3, "if (!rt.Tick()) return true;");
+			indent(out, 3, "switch (rt.Ptr()) {");
+
+			for (u32 offset = 0; offset + INS_HEADER_SIZE <= code.size(); ) {
+				u32 argc = code[offset + INS_ARGCOUNT];
+				if (offset + INS_HEADER_SIZE + argc * 2 > code.size()) break;
+
+				Ins ins(code.begin() + offset);
+				u32 next = offset + static_cast<u32>(ins.size());
+				transpileIns(out, ins, offset, next);
+				indent(out, 3, "} [[fallthrough]];");
+				offset = next;
+			}
+
+			// somewhere the transpiler doesn't know about, eg. the middle of an instruction. The interpreter takes over from there.
+			indent(out, 3, "default: return false;\n}");
+			indent(out, 2, "}");
+			indent(out, 1, "}");
+			out += "\n";
+		}
+	}
+
+	std::string Transpile(std::vector<i32> const& code, std::string const& tableName) {
+		if (code.size() < 2 || code.size() < 2 + static_cast<usize>(code[0]) * 3) {
+			Logger::Log(Logger::LL::Error) << "Can't transpile: the code header is malformed.";
+			return "";
+		}
+
+		std::string out = "// Generated by ZDrive::Compiler::Transpile. Do not edit.\n"
+			"// Link this into the host and pass " + tableName + " to ZVMOptions::nativeSubs.\n\n"
+			"#include \"ZDriveVM.hpp\"\n\n"
+			"namespace {\n"
+			"\tusing namespace ZDrive;\n"
+			"\tusing namespace ZDrive::VM;\n\n";
+		std::string table;
+
+		u32 rt_count = code[0];
+		for (u32 i = 0; i < rt_count; i++) {
+			u32 typeId = code[i * 3 + 2];
+			u32 size = code[i * 3 + 3];
+			u32 start = code[i * 3 + 4];
+			if (typeId != RT::BASE) continue;
+			if (static_cast<usize>(start) + size > code.size()) {
+				Logger::Log(Logger::LL::Error) << "Can't transpile sub " << i << ": it runs past the end of the code.";
+				return "";
+			}
+
+			std::span<const i32> sub(code.begin() + start, size);
+			transpileSub(out, sub, i);
+			table += std::format("\t\t{{ {}, 0x{:x}ull, &sub_{} }},\n", i, hashCode(sub), i);
+		}
+
+		if (table.empty()) {
+			out += "}\n\nextern const std::span<const ZDrive::VM::NativeSub> " + tableName + "{};\n";
+			return out;
+		}
+		out += "\tconst ZDrive::VM::NativeSub table[] = {\n" + table + "\t};\n}\n\n";
+		out += "extern const std::span<const ZDrive::VM::NativeSub> " + tableName + " = table;\n";
+		return out;
+	}
+}
\ No newline at end of file
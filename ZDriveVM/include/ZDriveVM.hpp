@@ -3,6 +3,7 @@
 #include "ZDriveCommon.hpp"
 
 #include <array>
+#include <atomic>
 #include <functional>
 #include <set>
 #include <span>
@@ -11,4 +12,8 @@
 #include "ZDriveVM/Structs.hpp"
 #include "ZDriveVM/VarTable.hpp"
 #include "ZDriveVM/Routine.hpp"
+#include "ZDriveVM/CompiledSub.hpp"
+#include "ZDriveVM/Native.hpp"
+#include "ZDriveVM/CommandQueue.hpp"
+#include "ZDriveVM/Snapshot.hpp"
 #include "ZDriveVM/VM.hpp"
\ No newline at end of file
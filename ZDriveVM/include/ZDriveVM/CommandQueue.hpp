@@ -0,0 +1,98 @@
+#pragma once
+
+namespace ZDrive::VM {
+	// something for the VM to do on behalf of the host, sent from any thread through ZVM::Post and done at the start of the next Update.
+	struct HostCommand {
+		enum class Type : u8 {
+			SET_VAR, // var of instance to value. Instance 0 is the VM's own vars (eg. DIFF), which are written even though scripts can't
+			SPAWN, // a clone of sub target with args in its IN0..IN(argc-1), put in group unless it's 0
+			KILL_GROUP, // the ZVM methods of the same names, on group
+			SUSPEND_GROUP,
+			RESUME_GROUP,
+			SET_GROUP_PRIORITY,
+			SET_PRIORITY, // of instance target
+		};
+
+		Type type = Type::SET_VAR;
+		u8 argc = 0;
+		// the instance for SET_VAR and SET_PRIORITY, the sub id for SPAWN.
+		u32 target = 0;
+		u32 var = 0;
+		u32 group = 0;
+		i32 priority = 0;
+		Value value;
+		std::array<Value, 8> args;
+		// when it was sent, from Now(). Post fills it in if it's 0. Set it earlier (eg. when the input was read) to measure the latency from there.
+		i64 queuedAt = 0;
+
+		// steady clock nanoseconds.
+		static i64 Now();
+
+		static inline HostCommand SetVar(u32 instance, u32 var, Value value) {
+			HostCommand cmd;
+			cmd.target = instance;
+			cmd.var = var;
+			cmd.value = value;
+			return cmd;
+		}
+		// only the first 8 args are passed.
+		static HostCommand Spawn(u32 subId, std::span<const Value> args = {}, u32 group = 0);
+		static inline HostCommand OnGroup(Type type, u32 group, i32 priority = 0) {
+			HostCommand cmd;
+			cmd.type = type;
+			cmd.group = group;
+			cmd.priority = priority;
+			return cmd;
+		}
+		static inline HostCommand SetPriority(u32 instance, i32 priority) {
+			HostCommand cmd;
+			cmd.type = Type::SET_PRIORITY;
+			cmd.target = instance;
+			cmd.priority = priority;
+			return cmd;
+		}
+	};
+
+	// a bounded lock-free queue any number of threads can push to and only the VM's thread takes from.
+	// each slot has a sequence number saying whose turn it is, pushers reserve slots by moving the tail forward and then publish them.
+	class CommandQueue {
+	public:
+		// rounded up to a power of two.
+		explicit CommandQueue(u32 capacity);
+
+		// returns false, dropping it, if the queue is full.
+		bool Push(HostCommand const& command);
+		// all of them or none of them. They're published so Drain sees either all or none, so they're done in the same Update.
+		bool Push(std::span<const HostCommand> commands);
+
+		// VM thread only. Calls func on each command pushed before it was called, oldest first, and returns how many there were.
+		// stops early at a slot that's been reserved but not published yet, what's left is picked up next time.
+		template<typename F>
+		u32 Drain(F&& func) {
+			const u64 end = tail.load(std::memory_order_acquire);
+			u32 count = 0;
+			for (; head < end; head++, count++) {
+				Cell& cell = cells[head & mask];
+				if (cell.seq.load(std::memory_order_acquire) != head + 1) break;
+				func(cell.command);
+				// free for the push one lap from now.
+				cell.seq.store(head + mask + 1, std::memory_order_release);
+			}
+			return count;
+		}
+
+		inline u32 Capacity() const { return static_cast<u32>(mask + 1); }
+
+	private:
+		struct Cell {
+			// pos when the slot is free for the push at pos, pos + 1 once that push has published it.
+			std::atomic<u64> seq;
+			HostCommand command;
+		};
+		std::unique_ptr<Cell[]> cells;
+		u64 mask;
+		// pushers and the VM on separate cache lines.
+		alignas(64) std::atomic<u64> tail = 0;
+		alignas(64) u64 head = 0;
+	};
+}
\ No newline at end of file
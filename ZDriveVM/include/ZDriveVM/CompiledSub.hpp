@@ -0,0 +1,58 @@
+#pragma once
+
+namespace ZDrive::VM {
+	class RoutineBase;
+
+	// A routine template lowered to pre-decoded instructions that are dispatched straight to a handler,
+	// skipping instruction decoding, argument vectors and the big switch in RoutineBase::Handle.
+	// Anything unusual (remote ValPtr writes, spawns, PRINT, priority changes, ...) deopts back to the interpreter.
+	class CompiledSub {
+	public:
+		struct CompiledIns;
+		// returns nullopt to deopt, in which case the instruction is handled by the interpreter instead.
+		// a handler must not deopt after it has had a side effect.
+		using FastHandler = std::optional<Routine::HandleResult>(*)(RoutineBase& rt, CompiledIns const& ins);
+
+		struct CompiledIns {
+			InsHead header;
+			u32 next = 0;
+			// whether it only touches the routine's own vars (no rng, output, spawns or VM state), so routines can run it interleaved.
+			bool lockstep = false;
+			FastHandler fast = nullptr;
+			Arg const* args = nullptr;
+		};
+
+		explicit CompiledSub(RoutineBase const& tmpl);
+
+		// returns nullptr if there is no instruction starting at offset.
+		inline CompiledIns const* Find(u32 offset) const {
+			if (offset >= indexByOffset.size() || indexByOffset[offset] == NOT_AN_INS) return nullptr;
+			return &instructions[indexByOffset[offset]];
+		}
+
+		inline usize InstructionCount() const { return instructions.size(); }
+		inline usize FastCount() const { return fastCount; }
+
+		// whether instances can be run in lockstep, ie. nothing in the sub can reach another routine's vars.
+		inline bool CanLockstep() const { return lockstep; }
+		// updates every routine in group, which have to be instances of this sub at the same ptr and CLOCK, in that order.
+		// each instruction is run over the whole group at once for as long as they stay in step and the instructions are lockstep ones.
+		// a routine that jumps somewhere else or gets to anything else is split off and finishes its update on its own, after the group.
+		// since the group only ever ran instructions that touch their own vars by then, this ends up the same as updating them one by one.
+		// returns true if there were no errors.
+		bool UpdateLockstep(std::span<RoutineBase* const> group) const;
+	private:
+		static constexpr u32 NOT_AN_INS = static_cast<u32>(-1);
+
+		std::vector<CompiledIns> instructions;
+		std::vector<Arg> args;
+		std::vector<u32> indexByOffset;
+		usize fastCount = 0;
+		bool lockstep = false;
+
+		static FastHandler SelectHandler(RoutineBase const& tmpl, Ins const& ins);
+		// whether ins can read or write another routine's vars, or vars only known at runtime.
+		static bool ReachesOthers(Ins const& ins);
+		static bool IsLockstep(RoutineBase const& tmpl, Ins const& ins);
+	};
+}
\ No newline at end of file
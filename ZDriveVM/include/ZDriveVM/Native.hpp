@@ -0,0 +1,56 @@
+#pragma once
+
+namespace ZDrive::VM {
+	// A RoutineBase that runs its sub as C++ generated by ZDrive::Compiler::Transpile instead of interpreting it.
+	// Everything else (vars, remote access, spawning, even the type id) is shared with RoutineBase, so the two can run side by side.
+	// The public methods below are the interface the generated code uses, they aren't meant for anything else.
+	class RoutineNative : public RoutineBase {
+	public:
+		RoutineNative(ZVM& vm, std::span<const i32> code, u32 subId, u32 instanceId, NativeSub::Fn fn) : RoutineBase(vm, code, subId, instanceId), fn(fn) {}
+
+		virtual std::unique_ptr<Routine> Clone(u32 newInstanceId) const override;
+
+		virtual bool Update() override;
+
+		inline u32& Ptr() { return ptr; }
+		inline u32& Next() { return nextPtr; }
+		inline Value& Clock() { return KnownVar(VTID::CLOCK); }
+
+		// whether an instruction with these masks runs at the current DIFF and RANK.
+		inline bool Runs(i32 diffMask, i32 rankMask) const {
+			return !((diff && !(diffMask & diff.value().s)) || (rank && !(rankMask & rank.value().s)));
+		}
+
+		// the transpiler only uses these for local vars that always exist.
+		inline Value Get(u32 id) { return GetVar(id).value(); }
+		inline bool Set(u32 id, Value val) { return !try_set(id, val); }
+		template <typename F>
+		inline bool SelfOp(u32 id, Value b, F func) {
+			std::optional<Value> a = GetVar(id);
+			if (!a) {
+				Logger::Log(Logger::LL::Error) << "Could not find variable " << id;
+				return false;
+			}
+			return !try_set(id, func(a.value(), b));
+		}
+		inline void Jump(u32 pos, i32 t) { OP_jmp(pos, t); }
+		bool Loop(u32 pos, i32 t, u32 iterId);
+		inline bool Vec2(u32 opcode, std::array<Value, 3> const& args) { return OP_vec2(opcode, args); }
+
+		// logs the instruction at offset if it failed, the same way the interpreter does.
+		void Check(bool success, u32 offset);
+		// handles the instruction at offset with the interpreter. Returns true if the routine is done for this frame.
+		bool Interpret(u32 offset);
+		// called every time the generated code goes around its loop, ie. on entry and every jump taken.
+		// returns false once the routine has used up its budget for this update, in which case it should stop where it is.
+		bool Tick();
+	private:
+		NativeSub::Fn fn;
+		// what Tick counts, and up to where. See Routine::Update.
+		u32 ticks = 0;
+		u32 budget = 0;
+		u32 limit = 0;
+		std::optional<Value> diff;
+		std::optional<Value> rank;
+	};
+}
\ No newline at end of file
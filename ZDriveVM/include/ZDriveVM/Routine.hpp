@@ -2,6 +2,8 @@
 
 namespace ZDrive::VM {
 	class ZVM;
+	class CompiledSub;
+	struct FastOps;
 
 	struct ProcessedInstruction {
 		u32 opcode = 0;
@@ -10,6 +12,10 @@ namespace ZDrive::VM {
 	using PrxIns = ProcessedInstruction;
 
 	class Routine : public IHasVarTable {
+		friend class CompiledSub;
+		friend struct FastOps;
+		friend struct LockstepOps;
+		friend class ZVM;
 	public:
 		class Compare {
 		public:
@@ -45,11 +51,27 @@ namespace ZDrive::VM {
 		inline i32 GetPriority() const { return priority; }
 		// Do not call this. This is for internal use only by ZVM::UpdatePriority. Use that to change the priority instead.
 		inline void SetPriority(i32 newPriority) { priority = newPriority; }
+		// blocked routines are waiting on a var and aren't updated until it's written, see ZVM::Block.
+		inline bool IsBlocked() const { return blocked; }
+		// 0 if it isn't in one. See ZVM::SetGroup.
+		inline u32 GetGroup() const { return group; }
+		// suspended routines aren't updated until their group is resumed.
+		inline bool IsSuspended() const { return suspended; }
+		// deferrable routines may be put off to a later frame when the VM is running late, see ZVMOptions::frameTimeBudget.
+		inline bool IsDeferrable() const { return deferrable; }
+		inline void SetDeferrable(bool enable) { deferrable = enable; }
+
+		// whether a remote read/write of this var may be served from another routine's inline cache.
+		// vars with side effects on read (eg. RAND) must return false.
+		inline virtual bool IsCacheable(u32) const { return true; }
 
 		std::optional<ProcessedInstruction> ProcessInstruction(Instruction const& ins);
+		std::optional<ProcessedInstruction> ProcessArgs(u32 opcode, std::span<const Arg> args);
 		std::optional<Value> ResolveArg(Arg const& arg);
 
-		bool Update();
+		virtual bool Update();
+		// finishes an update that already executed spent instructions elsewhere (eg. in a lockstep group or native code), which count towards the budget.
+		bool Update(u32 spent);
 
 #ifdef _DEBUG
 		void DebugDisassemble() const;
@@ -57,6 +79,18 @@ namespace ZDrive::VM {
 
 
 	protected:
+		// quickened form of a remote (ValPtr) access made by the instruction at offset 'site'.
+		// valid as long as the VM's routine epoch hasn't changed, ie. no routine has died since it was filled.
+		struct RemoteSlotCache {
+			u32 site = static_cast<u32>(-1);
+			u32 target = 0;
+			u64 epoch = 0;
+			Value* slot = nullptr;
+			bool read_only = false;
+			Routine* owner = nullptr;
+		};
+		static constexpr u32 REMOTE_CACHE_SIZE = 8;
+
 		ZVM& vm;
 		const std::span<const i32> code;
 
@@ -65,6 +99,45 @@ namespace ZDrive::VM {
 		u32 ptr = 0;
 		u32 nextPtr = 0;
 
+		std::array<RemoteSlotCache, REMOTE_CACHE_SIZE> remoteCache;
+
+		// wake lists, managed by ZVM::Block. <var, routine> of the routines waiting on a var of this one.
+		std::vector<std::pair<u32, Routine*>> waiters;
+		// a bit per var in waiters, so writes to anything else don't have to look.
+		u64 watched = 0;
+		// the routines this one is in the waiters of.
+		std::vector<Routine*> blockedOn;
+		bool blocked = false;
+		// the VM's TIME when it blocked, until its first update after being woken.
+		std::optional<u32> blockedAt;
+		// what WAIT_CHANGE is waiting for its var to change from.
+		std::optional<Value> waitFrom;
+
+		// groups, managed by ZVM::SetGroup. The routines in a group are a list through groupPrev and groupNext.
+		// templates keep a group too but aren't in a list, their clones join it when they're activated.
+		u32 group = 0;
+		Routine* groupPrev = nullptr;
+		Routine* groupNext = nullptr;
+		bool suspended = false;
+
+		// clones start off with their template's.
+		bool deferrable = false;
+		// how many frames in a row it's been put off.
+		u32 deferredFor = 0;
+
+		// Clone copies everything, but a clone hasn't waited on anything or been put off yet. Eg. a template that stopped
+		// on WAIT_CHANGE while loading would otherwise hand its own value of the var to every clone.
+		inline void ResetCloneState() { waitFrom.reset(); blockedAt.reset(); deferredFor = 0; }
+
+		inline bool IsWatched(u32 id) const { return id < FLAT_VARS && ((watched >> id) & 1); }
+		// sets a var someone is waiting on, waking them if it actually changed.
+		i32 SetWatchedVar(u32 id, Value val);
+		// returns the cached slot for a remote access from the current instruction, resolving and caching it on a miss.
+		// returns nullptr if the access can't be quickened, in which case the generic path should be used.
+		RemoteSlotCache* QuickenRemote(ValPtr vptr);
+		// takes what handling the instruction at ptr returned, logging it if it failed. Returns whether the update should stop.
+		bool Apply(HandleResult const& result, bool& handleSuccess);
+
 		i32 try_set(u32 id, Value const& val);
 		i32 unary_op(u32 id, Value a, std::function<Value(Value)> func);
 		i32 self_unary_op(u32 a_id, std::function<Value(Value)> func);
@@ -75,11 +148,15 @@ namespace ZDrive::VM {
 	};
 
 	class RoutineBase : public Routine {
+		friend class CompiledSub;
+		friend struct FastOps;
+		friend struct LockstepOps;
 	public:
 		RoutineBase(ZVM& vm, std::span<const i32> code, u32 subId, u32 instanceId) : Routine(vm, code, subId, instanceId) { InitializeDefVars(); }
 
 		virtual void InitializeDefVars() override;
 		virtual std::optional<Value> GetVar(u32 id) override;
+		inline virtual bool IsCacheable(u32 id) const override { return id < VTID::RAND || id > VTID::RANDRAD; }
 
 		inline constexpr u32 GetTypeIDStatic() const { return 0; }
 		inline virtual u32 GetTypeID() const override { return GetTypeIDStatic(); }
@@ -103,6 +180,16 @@ namespace ZDrive::VM {
 		static const std::function<Value(Value)> func_cos;
 		static const std::function<Value(Value)> func_tan;
 
+		// whether the JMP_* instruction jmpOpcode would jump on these args. nullopt if it isn't one.
+		static std::optional<bool> jumpTaken(u32 jmpOpcode, Value lhs, Value rhs, Value eps);
+
 		void OP_jmp(u32 pos, i32 t);
+		// returns false if there's no sub with that id. args go straight into the callee's IN0..IN7.
+		bool OP_call(u32 subId, std::span<const Value> args = {});
+		// the EMIT_* instructions. Counts over MAX_EMIT are clamped to it, negative ones are an error.
+		bool OP_emit(u32 opcode, std::vector<Value> const& args);
+		static constexpr i32 MAX_EMIT = 4096;
+		// the V2* instructions. Args they don't have are ignored.
+		bool OP_vec2(u32 opcode, std::array<Value, 3> const& args);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace ZDrive::VM {
+	// every live routine as of the end of an Update, in update order. One array per field, a routine's fields are at the same index in each.
+	struct FrameSnapshot {
+		// which Update it's from, counting from 0. UINT32_MAX before the first.
+		u32 frame = UINT32_MAX;
+		std::vector<u32> instance;
+		std::vector<f32> x, y, angle;
+		std::vector<i32> type, flags;
+
+		inline usize size() const { return instance.size(); }
+	};
+
+	// three snapshots, so the VM can fill one in while the renderer reads another, and the third always holds the newest finished one.
+	// neither side ever waits on the other, swapping one out is a single atomic exchange.
+	class SnapshotBuffer {
+	public:
+		// VM side. The one to fill in next.
+		inline FrameSnapshot& Back() { return buffers[back]; }
+		// VM side. Makes what's in Back() the newest and gives the VM the one it replaces.
+		inline void Publish() { back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX; }
+		// reader side, one thread at a time. The newest published snapshot, which the VM leaves alone until the next call.
+		inline FrameSnapshot const& Latest() {
+			if (middle.load(std::memory_order_relaxed) & FRESH) front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+			return buffers[front];
+		}
+
+	private:
+		static constexpr u8 INDEX = 3;
+		static constexpr u8 FRESH = 4;
+
+		std::array<FrameSnapshot, 3> buffers;
+		u8 back = 0;
+		// the one in between, with FRESH set if it was published since the reader last took it.
+		alignas(64) std::atomic<u8> middle = 1;
+		alignas(64) u8 front = 2;
+	};
+}
\ No newline at end of file
@@ -1,4 +1,111 @@
 #pragma once
 
 namespace ZDrive::VM {
+	class RoutineNative;
+
+	// one entry of the table generated by ZDrive::Compiler::Transpile.
+	struct NativeSub {
+		// runs the sub until it waits, yeilds or returns. Returns false if it reached an offset it has no code for,
+		// in which case the rest of the frame is left to the interpreter.
+		using Fn = bool(*)(RoutineNative& rt);
+
+		u32 subId;
+		// hashCode() of the sub's bytecode when it was transpiled. Stale native code is ignored.
+		u64 checksum;
+		Fn fn;
+	};
+
+	// when the ZVM builds the template of each sub.
+	enum class TemplateLoading : u8 {
+		EAGER, // all of them in the constructor, one after another
+		PARALLEL, // all of them in the constructor, across threads. Logs and results come out the same as EAGER
+		LAZY, // each one the first time it's started. Verification warnings show up then too, and aren't in the constructor's results
+	};
+
+	// what's done with a routine that uses up its instruction budget in one update, eg. because it's stuck in a loop that never waits.
+	enum class BudgetAction : u8 {
+		SUSPEND, // stop it where it is. It carries on from there next frame
+		KILL, // delete it
+	};
+
+	// where the ZVM's constructor spent its time, in seconds.
+	struct ZVMStartupReport {
+		u32 templateCount = 0;
+		// templates built lazily are counted and timed here too as they're built.
+		u32 templatesBuilt = 0;
+		u32 threads = 1;
+		// construct and verify are summed over threads.
+		f64 constructTime = 0;
+		f64 verifyTime = 0;
+		// of the update every template gets once it's built.
+		f64 updateTime = 0;
+		// of the whole constructor, ie. including starting the entry sub.
+		f64 totalTime = 0;
+	};
+
+	// what the last Update did.
+	struct ZVMFrameReport {
+		// in seconds.
+		f64 updateTime = 0;
+		// how many routines were updated, each one in a lockstep group included.
+		u32 updated = 0;
+		// deferrable routines put off to a later frame because it went over ZVMOptions::frameTimeBudget.
+		u32 deferred = 0;
+		// routines that weren't updated because the frame's instruction budget ran out.
+		u32 skipped = 0;
+		// host commands done at the start of it, see ZVM::Post.
+		u32 commands = 0;
+		// how long they waited, from their queuedAt until they were done, in seconds.
+		f64 commandLatency = 0; // the mean
+		f64 maxCommandLatency = 0;
+		// how much of updateTime went to filling in the snapshot, see ZVMOptions::snapshots.
+		f64 snapshotTime = 0;
+	};
+
+	// which of each routine's vars make up its fields in the frame snapshot, see ZVMOptions::snapshots. A field that's NIL is 0 for everyone.
+	struct SnapshotLayout {
+		// read as f32s.
+		u32 x = VTID::NIL;
+		u32 y = VTID::NIL;
+		u32 angle = VTID::NIL;
+		// read as i32s. Without a var the type is the routine's sub id.
+		u32 type = VTID::NIL;
+		u32 flags = VTID::NIL;
+	};
+
+	struct ZVMOptions {
+		// whether hot templates are compiled to the pre-decoded tier. Turn this off to debug the interpreter.
+		bool enableTierUp = true;
+		// how many instructions all instances of a template have to execute before it gets compiled.
+		u32 tierUpThreshold = 4096;
+		// transpiled subs to use instead of interpreting the matching templates.
+		std::span<const NativeSub> nativeSubs;
+		TemplateLoading templateLoading = TemplateLoading::PARALLEL;
+		// how many threads PARALLEL uses at most. 0 uses one per core.
+		u32 loadThreads = 0;
+		// whether compiled subs whose instances are next to each other in the update order, at the same instruction and CLOCK,
+		// are run as a group, each instruction over all of them at once. See CompiledSub::UpdateLockstep.
+		bool lockstep = false;
+		// runs of fewer instances than this are updated one at a time.
+		u32 lockstepMinGroup = 8;
+		// how many instructions a routine may execute in one update before overBudget is done with it, logging the sub and offset. 0 is no limit.
+		// native subs count the jumps they take instead.
+		u32 routineInstructionBudget = 1000000;
+		BudgetAction overBudget = BudgetAction::SUSPEND;
+		// how many instructions all routines together may execute in one Update. A routine that runs into it is stopped where it is,
+		// and the ones after it aren't updated at all that frame. 0 is no limit.
+		u32 frameInstructionBudget = 0;
+		// how long Update may take, in seconds, before it starts putting routines off. 0 is no limit.
+		// with a budget, deferrable routines (see Routine::SetDeferrable) with a priority of at most deferPriority still run in priority order,
+		// one at a time instead of in lockstep groups. Once the frame is over the budget, the ones after that point are put off to the next frame.
+		// everything else always runs. A routine is put off at most maxDeferFrames frames in a row.
+		f64 frameTimeBudget = 0;
+		i32 deferPriority = 0;
+		u32 maxDeferFrames = 8;
+		// how many host commands can be waiting for the next Update at once, see ZVM::Post. Rounded up to a power of two.
+		u32 commandQueueCapacity = 1024;
+		// whether Update ends by copying every routine's fields in snapshotLayout into a FrameSnapshot, for ZVM::LatestSnapshot.
+		bool snapshots = false;
+		SnapshotLayout snapshotLayout;
+	};
 }
\ No newline at end of file
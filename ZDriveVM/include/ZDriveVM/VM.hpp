@@ -10,14 +10,30 @@ namespace ZDrive::VM {
 		// 2: routine count is zero
 		// 3: no mainId was set
 		// 4: no routine with id mainId was found
-		ZVM(std::vector<i32>&& code, std::vector<i32>& results);
+		// 5: a template failed verification (it's still loaded, the interpreter reports the bad instructions when they run)
+		// with TemplateLoading::LAZY, 1 and 5 are only pushed for the entry sub, the rest are just logged when they're built.
+		ZVM(std::vector<i32>&& code, std::vector<i32>& results, ZVMOptions const& options = {});
 		~ZVM();
 
 		inline bool IsFinished() const { return finished; }
+		// incremented every time a routine is destroyed. Used to invalidate cached pointers into other routines.
+		inline u64 GetRoutineEpoch() const { return routineEpoch; }
+		inline ZVMStartupReport const& GetStartupReport() const { return startupReport; }
+		inline ZVMFrameReport const& GetFrameReport() const { return frameReport; }
 
 		// returns true if there were no errors
 		bool Update();
 
+		// Post and LatestSnapshot are the only methods that can be called from other threads while the VM runs.
+		// the commands are done at the start of the next Update, before any routine runs, in the order they were posted.
+		// returns false, dropping it, if the queue is full (see ZVMOptions::commandQueueCapacity).
+		inline bool Post(HostCommand const& command) { return commands.Push(command); }
+		// all of them are done in the same Update, or none of them are posted.
+		inline bool Post(std::span<const HostCommand> batch) { return commands.Push(batch); }
+		// the snapshot from the end of the newest Update, with ZVMOptions::snapshots on. One thread at a time (eg. the renderer's).
+		// it's left alone until the next call, however many Updates run in the meantime, so it can be read in place while the VM carries on.
+		inline FrameSnapshot const& LatestSnapshot() { return snapshots.Latest(); }
+
 		// returns nullopt if instanceId == 0
 		std::optional<std::reference_wrapper<Routine>> GetRoutineByInstance(u32 instanceId);
 		// return asker if instanceId == 0
@@ -33,9 +49,50 @@ namespace ZDrive::VM {
 
 		virtual void InitializeDefVars() override;
 
-		std::optional<std::reference_wrapper<Routine>> CloneAndActivateTemplate(u32 subId);
+		// blocks rt until one of the vars with these ids (relative to rt, like any ValPtr) is written with a new value, so ZVM::Update skips it until then.
+		// the write has to go through SetVar or SetVarByPtr, changing a var through a reference from GetVarRef doesn't wake anyone.
+		// when it's woken it catches up on CLOCK and TIME, so it ends up where it would have been had it polled every frame instead.
+		// returns false, leaving rt runnable, if a var can't be waited on (eg. CLOCK, RAND or anything past the flat vars).
+		bool Block(Routine& rt, std::span<const u32> ids);
+		// wakes everything waiting on var id of owner.
+		void Wake(Routine& owner, u32 id);
+
+		// the clone inherits and is passed vars from parent, if given, then args are written into its IN0..IN7.
+		std::optional<std::reference_wrapper<Routine>> CloneAndActivateTemplate(u32 subId, Routine const* parent = nullptr, std::span<const Value> args = {});
+		// spawns count clones of subId at once, same as calling CloneAndActivateTemplate count times but cheaper.
+		// args holds the args of every clone one after the other, args.size() / count each. Returns how many were spawned.
+		u32 CloneAndActivateTemplates(u32 subId, Routine const* parent, u32 count, std::span<const Value> args = {});
 		void UpdatePriority(u32 instance, i32 newPriority);
 
+		// groups. Group 0 is no group. Clones join their template's group if its first update put it in one, otherwise their parent's.
+		// these take time proportional to the size of the group, not to how many routines are active.
+		// moves rt into group, taking it out of the one it was in.
+		void SetGroup(Routine& rt, u32 group);
+		// marks everything in the group to be deleted, like they had returned, and empties the group. Update frees them when it gets to them. Returns how many.
+		u32 KillGroup(u32 group);
+		// suspended routines are skipped by Update (so their CLOCK stops) until they're resumed. Both return how many.
+		u32 SuspendGroup(u32 group);
+		u32 ResumeGroup(u32 group);
+		// UpdatePriority on every routine in the group. Returns how many.
+		u32 SetGroupPriority(u32 group, i32 newPriority);
+		u32 GroupSize(u32 group) const;
+
+		// returns nullptr if the template for subId hasn't tiered up (yet).
+		inline CompiledSub const* GetCompiledSub(u32 subId) const { return subId < compiledSubs.size() ? compiledSubs[subId].get() : nullptr; }
+		// called by routines after each update with the number of instructions they executed. Drives tier-up.
+		void CountExecution(u32 subId, u32 count);
+		// how many instructions the routine being updated may execute, see ZVMOptions::routineInstructionBudget.
+		// the most it could be is UINT32_MAX, so routines can count up to it without checking for a limit.
+		u32 RoutineBudget() const;
+		// how many the frame has left for it, see ZVMOptions::frameInstructionBudget.
+		u32 FrameBudgetLeft() const;
+		// called by routines after each update with the number of instructions they executed (or jumps, for native subs).
+		inline void ChargeFrame(u64 count) { frameExecuted += count; }
+		// called by routines that used up their RoutineBudget. Logs where rt is stuck, then kills it or lets it carry on from there next frame.
+		void OverBudget(Routine& rt, u32 executed);
+		// enabling only allows templates to tier up from now on. Disabling also throws away everything already compiled.
+		void SetTierUp(bool enable);
+
 #ifdef _DEBUG
 		void DebugDisassemble() const;
 #endif // _DEBUG
@@ -43,13 +100,65 @@ namespace ZDrive::VM {
 	private:
 		ZVM();
 
+		// checks a template's instructions against the op table, logging a warning for each problem. Returns whether there were none.
+		bool VerifyTemplate(u32 subId, std::span<const i32> sub) const;
+
+		// creates and verifies the template for subId. Doesn't touch the rest of the VM, so different ids can be built on different threads at once.
+		// pushes error codes to results like the constructor, and adds to the construct and verify times in report.
+		std::unique_ptr<Routine> BuildTemplate(u32 subId, std::vector<i32>& results, ZVMStartupReport& report);
+		// gives a built template its first update and stores it. Only call on the VM's thread.
+		void FinishTemplate(u32 subId, std::unique_ptr<Routine> rt);
+		// builds the template first if it's lazy and hasn't been yet. Returns nullptr if there's no such template or it was deleted on construction.
+		Routine* GetTemplate(u32 subId);
+
+		ZVMOptions options;
+		ZVMStartupReport startupReport;
+		ZVMFrameReport frameReport;
 		bool finished = false;
 		u32 instanceTracker = 1;
+		u64 routineEpoch = 0;
+		// instructions executed in the current Update.
+		u64 frameExecuted = 0;
 
+		// indexed by sub id. Null for templates that aren't built yet, or were deleted on construction.
 		std::vector<std::unique_ptr<Routine>> templates;
+		std::vector<bool> templateBuilt;
+		std::vector<std::unique_ptr<CompiledSub>> compiledSubs;
+		std::vector<u32> execCounts;
 		std::set<std::unique_ptr<Routine>, Routine::Compare> active;
 		std::vector<Routine*> toBeResorted;
+		std::vector<RoutineBase*> lockstepGroup;
+		// whether Update may put rt off, rather than always running it.
+		bool CanDefer(Routine const& rt) const;
+		CommandQueue commands;
+		// does everything posted so far, filling in the frame report's command stats.
+		void ApplyCommands();
+		void Apply(HostCommand const& cmd);
+		SnapshotBuffer snapshots;
+		// fills in the back snapshot and publishes it.
+		void TakeSnapshot();
+
+		struct Group {
+			Routine* head = nullptr;
+			u32 size = 0;
+		};
+		std::unordered_map<u32, Group> groups;
+		// takes rt out of its group's list, it keeps the tag.
+		void UnlinkGroup(Routine& rt);
+		// puts a clone that's being activated in its group.
+		void JoinSpawnGroup(Routine& clone, Routine const* parent);
+		// returns the size of the group.
+		template<typename F>
+		u32 ForEachInGroup(u32 group, F&& func);
 
 		void ResortActive();
+		// moves a routine that was just woken up to where it would have been had it polled every frame.
+		void CatchUp(Routine& rt, u32 frame);
+		// if first starts a lockstep group, updates the group and returns the iterator past it. Otherwise returns first.
+		std::set<std::unique_ptr<Routine>, Routine::Compare>::iterator UpdateLockstep(std::set<std::unique_ptr<Routine>, Routine::Compare>::iterator first, u32 frame, bool& success);
+		// takes rt out of every wake list it's in and makes it runnable again.
+		void Unblock(Routine& rt);
+		// returns nullptr if there is no native code for subId, or it was generated from different bytecode.
+		NativeSub::Fn FindNativeSub(u32 subId, std::span<const i32> sub) const;
 	};
 }
\ No newline at end of file
@@ -5,7 +5,7 @@ namespace ZDrive::VM {
 		Value val;
 		bool read_only;
 		bool inherit;
-		u32 pass_dest; // use VTID::NIL to not pass
+		u32 pass_dest; // the var of the spawning routine this one is set to on spawn. Use VTID::NIL to not pass
 
 		VarTableVar(Value val = Value(), bool read_only = false, bool inherit = false, u32 pass_dest = VTID::NIL) : val(val), read_only(read_only), inherit(inherit), pass_dest(pass_dest) {}
 	};
@@ -20,6 +20,11 @@ namespace ZDrive::VM {
 
 	class IHasVarTable {
 	public:
+		// vars with ids below this are kept in a flat array with their flags as bitmasks, so spawning copies them in bulk.
+		// the rest (eg. entity vars) are kept in a map.
+		static constexpr u32 FLAT_VARS = 64;
+		static_assert(VTID::LAST_BASE <= FLAT_VARS);
+
 		// Initializes the VarTable variables. Only initialized variables exist and this is the only way to make a variable exist within the VarTable.
 		void InitializeVars(std::vector<VarInitializeInfo> const& vars);
 		// Calls InitializeVars with a default set of variables.
@@ -37,17 +42,39 @@ namespace ZDrive::VM {
 		// Gets a variable by reference. Returns a modifyable reference as long as the variable exists, regardless of read_only status.
 		virtual std::optional<std::reference_wrapper<Value>> GetVarRef(u32 id);
 
-		// copies values marked as inherit on this from other to this.
-		virtual void InheritVarsFrom(IHasVarTable& other);
-		// copies values marked as inherit on this from this to other. Does not modify this.
-		virtual void InheritVarsTo(IHasVarTable& other);
-		// copies values marked as pass on this to this from other.
-		virtual void PassVarsFrom(IHasVarTable& other);
-		// copies values marked as pass on this to other from this. Does not modify this.
-		virtual void PassVarsTo(IHasVarTable& other);
+		inline bool HasVar(u32 id) const { return id < FLAT_VARS ? (exists >> id) & 1 : overflow.contains(id); }
+		inline bool IsReadOnly(u32 id) const {
+			if (id < FLAT_VARS) return (readOnly >> id) & 1;
+			auto res = overflow.find(id);
+			return res != overflow.end() && res->second.read_only;
+		}
+		// the var's slot, without going through the virtual getters (so no side effects, eg. from RAND). nullptr if it doesn't exist.
+		// slots don't move for as long as the table exists.
+		inline Value* FindVar(u32 id) {
+			if (id < FLAT_VARS) return (exists >> id) & 1 ? &values[id] : nullptr;
+			auto res = overflow.find(id);
+			return res == overflow.end() ? nullptr : &res->second.val;
+		}
+
+		// copies values marked as inherit on this from other.
+		void InheritVarsFrom(IHasVarTable const& other);
+		// sets values marked as pass on this to their pass_dest on other.
+		void PassVarsFrom(IHasVarTable const& other);
 	protected:
 		IHasVarTable() {}
 
-		std::unordered_map<u32, VarTableVar> vt;
+		// for vars that always exist, like CLOCK on routines.
+		inline Value& KnownVar(u32 id) { return values[id]; }
+
+	private:
+		std::array<Value, FLAT_VARS> values;
+		// a bit per flat var.
+		u64 exists = 0;
+		u64 readOnly = 0;
+		u64 inherit = 0;
+		u64 pass = 0;
+		std::array<u8, FLAT_VARS> passFrom{};
+
+		std::unordered_map<u32, VarTableVar> overflow;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "ZDriveVM.hpp"
+
+#include <bit>
+#include <chrono>
+
+namespace ZDrive::VM {
+
+	i64 HostCommand::Now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	HostCommand HostCommand::Spawn(u32 subId, std::span<const Value> args, u32 group) {
+		HostCommand cmd;
+		cmd.type = Type::SPAWN;
+		cmd.target = subId;
+		cmd.group = group;
+		cmd.argc = static_cast<u8>(min(args.size(), cmd.args.size()));
+		std::copy_n(args.begin(), cmd.argc, cmd.args.begin());
+		return cmd;
+	}
+
+	CommandQueue::CommandQueue(u32 capacity) {
+		const u64 size = std::bit_ceil(max(capacity, 2u));
+		cells = std::make_unique<Cell[]>(size);
+		mask = size - 1;
+		for (u64 i = 0; i < size; i++) cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	bool CommandQueue::Push(HostCommand const& command) {
+		return Push(std::span<const HostCommand>(&command, 1));
+	}
+
+	bool CommandQueue::Push(std::span<const HostCommand> commands) {
+		const u64 n = commands.size();
+		if (n == 0) return true;
+		if (n > mask + 1) return false;
+
+		u64 pos = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			bool stale = false;
+			for (u64 i = 0; i < n; i++) {
+				const u64 seq = cells[(pos + i) & mask].seq.load(std::memory_order_acquire);
+				if (seq == pos + i) continue;
+				// the VM hasn't taken what was there a lap ago yet.
+				if (seq < pos + i) return false;
+				// someone else got there first.
+				stale = true;
+				break;
+			}
+			if (stale) {
+				pos = tail.load(std::memory_order_relaxed);
+				continue;
+			}
+			// the slots can't be taken by anyone else in between, only by whoever moves the tail past them.
+			if (tail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed)) break;
+		}
+
+		const i64 now = HostCommand::Now();
+		for (u64 i = 0; i < n; i++) {
+			HostCommand& slot = cells[(pos + i) & mask].command;
+			slot = commands[i];
+			if (!slot.queuedAt) slot.queuedAt = now;
+		}
+		// the first one last, so Drain can't get to any of them before they're all there.
+		for (u64 i = n; i-- > 0; ) cells[(pos + i) & mask].seq.store(pos + i + 1, std::memory_order_release);
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,633 @@
+#include "ZDriveVM.hpp"
+
+#include <numeric>
+
+namespace ZDrive::VM {
+	using CIns = CompiledSub::CompiledIns;
+	using Result = std::optional<Routine::HandleResult>;
+
+	// The handlers behind the compiled tier. They mirror RoutineBase::Handle exactly, including reading args in order,
+	// so that switching tiers never changes what a script does (or how many times it draws from RAND).
+	struct FastOps {
+		static constexpr Routine::HandleResult OK{ true, false, false };
+
+		// SelectHandler guarantees every VTREF arg of a compiled instruction is a local var that exists.
+		static inline Value read(RoutineBase& rt, Arg const& arg) {
+			return arg.type == AT::VTREF ? rt.GetVar(arg.val).value() : arg.val;
+		}
+
+		static inline Result write(RoutineBase& rt, u32 id, Value val) {
+			return Routine::HandleResult{ !rt.try_set(id, val), false, false };
+		}
+
+		static Value iadd(Value a, Value b) { return a.s + b.s; }
+		static Value isub(Value a, Value b) { return a.s - b.s; }
+		static Value imul(Value a, Value b) { return a.s * b.s; }
+		static Value idiv(Value a, Value b) { return a.s / b.s; }
+		static Value imod(Value a, Value b) { return a.s % b.s; }
+		static Value imod2(Value a, Value b) { return b.s % a.s; }
+		static Value fadd(Value a, Value b) { return a.f + b.f; }
+		static Value fsub(Value a, Value b) { return a.f - b.f; }
+		static Value fmul(Value a, Value b) { return a.f * b.f; }
+		static Value fdiv(Value a, Value b) { return a.f / b.f; }
+		static Value fmod(Value a, Value b) { return fmodf(a.f, b.f); }
+		static Value fmod2(Value a, Value b) { return fmodf(b.f, a.f); }
+		static Value sin(Value a) { return Math::sin(a.f); }
+		static Value cos(Value a) { return Math::cos(a.f); }
+		static Value tan(Value a) { return Math::tan(a.f); }
+		static Value copy(Value a) { return a; }
+		static Value ftoi(Value a) { return static_cast<i32>(a.f); }
+		static Value itof(Value a) { return static_cast<f32>(a.s); }
+
+		static bool equ(Value const* a) { return a[0] == a[1]; }
+		static bool equ_f(Value const* a) { return fabsf(a[0].f - a[1].f) < fabsf(a[2].f); }
+		static bool neq(Value const* a) { return a[0] != a[1]; }
+		static bool neq_f(Value const* a) { return fabsf(a[0].f - a[1].f) > fabsf(a[2].f); }
+		static bool lt(Value const* a) { return a[0].s < a[1].s; }
+		static bool lt_f(Value const* a) { return a[0].f < a[1].f; }
+		static bool lte(Value const* a) { return a[0].s <= a[1].s; }
+		static bool lte_f(Value const* a) { return a[0].f <= a[1].f + copysignf(a[2].f, a[1].f); }
+		static bool gt(Value const* a) { return a[0].s > a[1].s; }
+		static bool gt_f(Value const* a) { return a[0].f > a[1].f; }
+		static bool gte(Value const* a) { return a[0].s >= a[1].s; }
+		static bool gte_f(Value const* a) { return a[0].f >= a[1].f - copysignf(a[2].f, a[1].f); }
+
+		static Result nop(RoutineBase&, CIns const&) { return OK; }
+		static Result ret(RoutineBase&, CIns const&) { return Routine::HandleResult{ true, true, true }; }
+		static Result yeild(RoutineBase&, CIns const&) { return Routine::HandleResult{ true, true, false }; }
+
+		static Result wait(RoutineBase& rt, CIns const& ins) {
+			i32 t = read(rt, ins.args[0]).s;
+			rt.KnownVar(VTID::CLOCK).s -= t;
+			return OK;
+		}
+
+		static Result jmp(RoutineBase& rt, CIns const& ins) {
+			Value pos = read(rt, ins.args[0]);
+			Value t = read(rt, ins.args[1]);
+			rt.OP_jmp(pos, t);
+			return OK;
+		}
+
+		static Result loop(RoutineBase& rt, CIns const& ins) {
+			Value pos = read(rt, ins.args[0]);
+			Value t = read(rt, ins.args[1]);
+			u32 iterId = read(rt, ins.args[2]);
+			if (ValPtr(iterId).b) return std::nullopt;
+			auto iterOpt = rt.GetVar(iterId);
+			if (!iterOpt) {
+				Logger::Log(Logger::LL::Error) << "Could not find variable " << iterId;
+				return Routine::HandleResult{ false, false, false };
+			}
+			Value iter = iterOpt.value();
+			if (!iter.u) return OK;
+			rt.OP_jmp(pos, t);
+			iter.u--;
+			if (rt.SetVar(iterId, iter) == 2) {
+				Logger::Log(Logger::LL::Error) << "Variable " << iterId << " is read only.";
+				return Routine::HandleResult{ false, false, false };
+			}
+			return OK;
+		}
+
+		template <Value(*F)(Value)>
+		static Result unary(RoutineBase& rt, CIns const& ins) {
+			u32 id = read(rt, ins.args[0]);
+			if (ValPtr(id).b) return std::nullopt;
+			Value a = read(rt, ins.args[1]);
+			return write(rt, id, F(a));
+		}
+
+		template <Value(*F)(Value, Value)>
+		static Result binary(RoutineBase& rt, CIns const& ins) {
+			u32 id = read(rt, ins.args[0]);
+			if (ValPtr(id).b) return std::nullopt;
+			Value a = read(rt, ins.args[1]);
+			Value b = read(rt, ins.args[2]);
+			return write(rt, id, F(a, b));
+		}
+
+		static inline Result selfBinaryWith(RoutineBase& rt, u32 id, Value b, Value(*f)(Value, Value)) {
+			if (ValPtr(id).b) return std::nullopt;
+			std::optional<Value> a = rt.GetVar(id);
+			if (!a) {
+				Logger::Log(Logger::LL::Error) << "Could not find variable " << id;
+				return Routine::HandleResult{ false, false, false };
+			}
+			return write(rt, id, f(a.value(), b));
+		}
+
+		template <Value(*F)(Value, Value)>
+		static Result selfBinary(RoutineBase& rt, CIns const& ins) {
+			u32 id = read(rt, ins.args[0]);
+			if (ValPtr(id).b) return std::nullopt;
+			Value b = read(rt, ins.args[1]);
+			return selfBinaryWith(rt, id, b, F);
+		}
+
+		// iinc and friends add the *bits* 1, same as RoutineBase::Handle does.
+		template <Value(*F)(Value, Value)>
+		static Result selfStep(RoutineBase& rt, CIns const& ins) {
+			return selfBinaryWith(rt, read(rt, ins.args[0]), 1, F);
+		}
+
+		template <bool(*C)(Value const*), u32 N>
+		static Result jmpIf(RoutineBase& rt, CIns const& ins) {
+			Value pos = read(rt, ins.args[0]);
+			Value t = read(rt, ins.args[1]);
+			Value vals[3];
+			for (u32 i = 0; i < N; i++) vals[i] = read(rt, ins.args[2 + i]);
+			if (C(vals)) rt.OP_jmp(pos, t);
+			return OK;
+		}
+
+		static Result normRad(RoutineBase& rt, CIns const& ins) {
+			u32 id = read(rt, ins.args[0]);
+			if (ValPtr(id).b) return std::nullopt;
+			std::optional<Value> a = rt.GetVar(id);
+			if (!a) {
+				Logger::Log(Logger::LL::Error) << "Could not find variable " << id;
+				return Routine::HandleResult{ false, false, false };
+			}
+			return write(rt, id, Math::normRad(a.value().f));
+		}
+
+		static Result circlePos(RoutineBase& rt, CIns const& ins) {
+			u32 idX = read(rt, ins.args[0]);
+			u32 idY = read(rt, ins.args[1]);
+			if (ValPtr(idX).b || ValPtr(idY).b) return std::nullopt;
+			f32 r = read(rt, ins.args[2]);
+			f32 theta = read(rt, ins.args[3]);
+			bool success = !rt.try_set(idX, r * Math::cos(theta));
+			success &= !rt.try_set(idY, r * Math::sin(theta));
+			return Routine::HandleResult{ success, false, false };
+		}
+
+		// the V2* instructions. Like circlePos, vectors in other routines go back to the interpreter.
+		// the vector ids always come before the values, so this deopts before anything with a side effect was read.
+		template <u32 argc>
+		static Result vec2(RoutineBase& rt, CIns const& ins) {
+			std::array<Value, 3> args{};
+			for (u32 i = 0; i < argc; i++) {
+				args[i] = read(rt, ins.args[i]);
+				if (isVec2Arg(ins.header.ins, i) && ValPtr(args[i]).b) return std::nullopt;
+			}
+			return Routine::HandleResult{ rt.OP_vec2(ins.header.ins, args), false, false };
+		}
+
+		static Result distance(RoutineBase& rt, CIns const& ins) {
+			u32 id = read(rt, ins.args[0]);
+			if (ValPtr(id).b) return std::nullopt;
+			f32 x1 = read(rt, ins.args[1]);
+			f32 y1 = read(rt, ins.args[2]);
+			f32 x2 = read(rt, ins.args[3]);
+			f32 y2 = read(rt, ins.args[4]);
+			f32 dx = x2 - x1;
+			f32 dy = y2 - y1;
+			return write(rt, id, Math::sqrt(dx * dx + dy * dy));
+		}
+
+		static Result angle(RoutineBase& rt, CIns const& ins) {
+			u32 id = read(rt, ins.args[0]);
+			if (ValPtr(id).b) return std::nullopt;
+			f32 x1 = read(rt, ins.args[1]);
+			f32 y1 = read(rt, ins.args[2]);
+			f32 x2 = read(rt, ins.args[3]);
+			f32 y2 = read(rt, ins.args[4]);
+			return write(rt, id, Math::atan2(y1 - y2, x1 - x2));
+		}
+	};
+
+	// kernels for running one instruction over a lockstep group, for the instructions bullets spend most of their time in.
+	// each lane's vars stay in its routine (other routines and the remote caches hold pointers into them), so these skip the
+	// per-lane dispatch and virtual var access rather than moving vars around. The trig ones do gather their angles into a column
+	// for Math::sinCos, which takes four at a time in deterministic mode.
+	// lanes a kernel can't take (a destination that's read only, waited on or missing) go in rest, for the regular handlers.
+	struct LockstepOps {
+		using Lanes = std::span<RoutineBase* const>;
+
+		struct Scratch {
+			std::vector<RoutineBase*> lanes;
+			std::vector<f32> radius;
+			std::vector<f32> angle;
+			std::vector<f32> sin;
+			std::vector<f32> cos;
+		};
+
+		// lockstep instructions only read local vars that exist, see CompiledSub::IsLockstep.
+		static inline Value read(RoutineBase& rt, Arg const& arg) {
+			return arg.type == AT::VTREF ? *rt.FindVar(arg.val) : arg.val;
+		}
+
+		// nullptr if writing the var has to go through SetVar.
+		static inline Value* slot(RoutineBase& rt, u32 id) {
+			Value* var = rt.FindVar(id);
+			return var && !rt.IsReadOnly(id) && !rt.IsWatched(id) ? var : nullptr;
+		}
+
+		template <Value(*F)(Value)>
+		static void unary(CIns const& ins, Lanes lanes, Scratch&, std::vector<RoutineBase*>& rest) {
+			for (RoutineBase* rt : lanes) {
+				Value* dest = slot(*rt, ins.args[0].val);
+				if (dest) *dest = F(read(*rt, ins.args[1]));
+				else rest.push_back(rt);
+			}
+		}
+
+		template <Value(*F)(Value, Value)>
+		static void binary(CIns const& ins, Lanes lanes, Scratch&, std::vector<RoutineBase*>& rest) {
+			for (RoutineBase* rt : lanes) {
+				Value* dest = slot(*rt, ins.args[0].val);
+				if (dest) *dest = F(read(*rt, ins.args[1]), read(*rt, ins.args[2]));
+				else rest.push_back(rt);
+			}
+		}
+
+		template <Value(*F)(Value, Value)>
+		static void selfBinary(CIns const& ins, Lanes lanes, Scratch&, std::vector<RoutineBase*>& rest) {
+			for (RoutineBase* rt : lanes) {
+				Value* dest = slot(*rt, ins.args[0].val);
+				if (dest) *dest = F(*dest, read(*rt, ins.args[1]));
+				else rest.push_back(rt);
+			}
+		}
+
+		template <Value(*F)(Value, Value)>
+		static void selfStep(CIns const& ins, Lanes lanes, Scratch&, std::vector<RoutineBase*>& rest) {
+			for (RoutineBase* rt : lanes) {
+				Value* dest = slot(*rt, ins.args[0].val);
+				if (dest) *dest = F(*dest, 1);
+				else rest.push_back(rt);
+			}
+		}
+
+		static void wait(CIns const& ins, Lanes lanes, Scratch&, std::vector<RoutineBase*>&) {
+			for (RoutineBase* rt : lanes) rt->KnownVar(VTID::CLOCK).s -= read(*rt, ins.args[0]).s;
+		}
+
+		// sin and cos of arg 'theta' of every lane that has all of the vars in ids, which are kept in s.lanes.
+		static void sinCos(CIns const& ins, Lanes lanes, Scratch& s, std::vector<RoutineBase*>& rest, std::initializer_list<u32> ids, u32 r, u32 theta) {
+			s.lanes.clear();
+			s.radius.clear();
+			s.angle.clear();
+			for (RoutineBase* rt : lanes) {
+				if (std::ranges::any_of(ids, [&](u32 id) { return !slot(*rt, id); })) {
+					rest.push_back(rt);
+					continue;
+				}
+				s.lanes.push_back(rt);
+				s.radius.push_back(read(*rt, ins.args[r]));
+				s.angle.push_back(read(*rt, ins.args[theta]));
+			}
+			s.sin.resize(s.angle.size());
+			s.cos.resize(s.angle.size());
+			Math::sinCos(s.angle, s.sin, s.cos);
+		}
+
+		static void circlePos(CIns const& ins, Lanes lanes, Scratch& s, std::vector<RoutineBase*>& rest) {
+			u32 idX = ins.args[0].val;
+			u32 idY = ins.args[1].val;
+			sinCos(ins, lanes, s, rest, { idX, idY }, 2, 3);
+			for (usize i = 0; i < s.lanes.size(); i++) {
+				*s.lanes[i]->FindVar(idX) = s.radius[i] * s.cos[i];
+				*s.lanes[i]->FindVar(idY) = s.radius[i] * s.sin[i];
+			}
+		}
+
+		// same order as RoutineBase::Handle, which matters if any of the ids are the same.
+		static void circlePosAdd(CIns const& ins, Lanes lanes, Scratch& s, std::vector<RoutineBase*>& rest) {
+			u32 idX = ins.args[0].val;
+			u32 idY = ins.args[1].val;
+			u32 posX = ins.args[4].val;
+			u32 posY = ins.args[5].val;
+			sinCos(ins, lanes, s, rest, { idX, idY, posX, posY }, 2, 3);
+			for (usize i = 0; i < s.lanes.size(); i++) {
+				RoutineBase& rt = *s.lanes[i];
+				*rt.FindVar(idX) = s.radius[i] * s.cos[i];
+				*rt.FindVar(idY) = s.radius[i] * s.sin[i];
+				*rt.FindVar(posX) = FastOps::fadd(*rt.FindVar(posX), *rt.FindVar(idX));
+				*rt.FindVar(posY) = FastOps::fadd(*rt.FindVar(posY), *rt.FindVar(idY));
+			}
+		}
+
+		static void polarAdd(CIns const& ins, Lanes lanes, Scratch& s, std::vector<RoutineBase*>& rest) {
+			u32 id = ins.args[0].val;
+			sinCos(ins, lanes, s, rest, { id, id + 1 }, 1, 2);
+			for (usize i = 0; i < s.lanes.size(); i++) {
+				Value* x = s.lanes[i]->FindVar(id);
+				Value* y = s.lanes[i]->FindVar(id + 1);
+				f32 nx = x->f + s.radius[i] * s.cos[i];
+				f32 ny = y->f + s.radius[i] * s.sin[i];
+				*x = nx;
+				*y = ny;
+			}
+		}
+
+		// returns false if there's no kernel for the instruction.
+		static bool run(CIns const& ins, Lanes lanes, Scratch& s, std::vector<RoutineBase*>& rest) {
+#define kernel(code, ...) case code: __VA_ARGS__(ins, lanes, s, rest); return true
+
+			switch (ins.header.ins) {
+				kernel(INS::WAIT, wait);
+				kernel(INS::SET, unary<FastOps::copy>);
+				kernel(INS::ISET, unary<FastOps::ftoi>);
+				kernel(INS::FSET, unary<FastOps::itof>);
+				kernel(INS::IADD, selfBinary<FastOps::iadd>);
+				kernel(INS::ISUB, selfBinary<FastOps::isub>);
+				kernel(INS::IMUL, selfBinary<FastOps::imul>);
+				kernel(INS::FADD, selfBinary<FastOps::fadd>);
+				kernel(INS::FSUB, selfBinary<FastOps::fsub>);
+				kernel(INS::FMUL, selfBinary<FastOps::fmul>);
+				kernel(INS::FDIV, selfBinary<FastOps::fdiv>);
+				kernel(INS::ISET_ADD, binary<FastOps::iadd>);
+				kernel(INS::ISET_SUB, binary<FastOps::isub>);
+				kernel(INS::ISET_MUL, binary<FastOps::imul>);
+				kernel(INS::FSET_ADD, binary<FastOps::fadd>);
+				kernel(INS::FSET_SUB, binary<FastOps::fsub>);
+				kernel(INS::FSET_MUL, binary<FastOps::fmul>);
+				kernel(INS::FSET_DIV, binary<FastOps::fdiv>);
+				kernel(INS::IINC, selfStep<FastOps::iadd>);
+				kernel(INS::FINC, selfStep<FastOps::fadd>);
+				kernel(INS::IDEC, selfStep<FastOps::isub>);
+				kernel(INS::FDEC, selfStep<FastOps::fsub>);
+				kernel(INS::FSET_SIN, unary<FastOps::sin>);
+				kernel(INS::FSET_COS, unary<FastOps::cos>);
+				kernel(INS::MATHCIRCLEPOS, circlePos);
+				kernel(INS::CIRCLEPOS_ADD, circlePosAdd);
+				kernel(INS::V2POLAR_ADD, polarAdd);
+			default: return false;
+			}
+
+#undef kernel
+		}
+	};
+
+	CompiledSub::CompiledSub(RoutineBase const& tmpl) {
+		std::span<const i32> code = tmpl.code;
+		indexByOffset.assign(code.size(), NOT_AN_INS);
+
+		// pointers into args are only taken once it has stopped growing.
+		std::vector<u32> argStarts;
+		// native subs run their own code instead.
+		lockstep = !dynamic_cast<RoutineNative const*>(&tmpl);
+		for (u32 offset = 0; offset + INS_HEADER_SIZE <= code.size(); ) {
+			u32 argc = code[offset + INS_ARGCOUNT];
+			if (offset + INS_HEADER_SIZE + argc * 2 > code.size()) break;
+
+			Ins ins(code.begin() + offset);
+			CompiledIns c_ins;
+			c_ins.header = ins.header;
+			c_ins.next = offset + static_cast<u32>(ins.size());
+			c_ins.fast = SelectHandler(tmpl, ins);
+			c_ins.lockstep = IsLockstep(tmpl, ins);
+			if (c_ins.fast) fastCount++;
+			if (ReachesOthers(ins)) lockstep = false;
+
+			indexByOffset[offset] = static_cast<u32>(instructions.size());
+			argStarts.push_back(static_cast<u32>(args.size()));
+			args.insert(args.end(), ins.args.begin(), ins.args.end());
+			instructions.push_back(c_ins);
+			offset = c_ins.next;
+		}
+
+		for (usize i = 0; i < instructions.size(); i++) instructions[i].args = args.data() + argStarts[i];
+	}
+
+	CompiledSub::FastHandler CompiledSub::SelectHandler(RoutineBase const& tmpl, Ins const& ins) {
+		FastHandler handler = nullptr;
+
+#define fast(code, ...) case code: handler = &FastOps::__VA_ARGS__; break
+
+		switch (ins.header.ins) {
+			fast(INS::NOP, nop);
+			fast(INS::RET, ret);
+			fast(INS::WAIT, wait);
+			fast(INS::JMP, jmp);
+			fast(INS::LOOP, loop);
+			fast(INS::SET, unary<FastOps::copy>);
+			fast(INS::ISET, unary<FastOps::ftoi>);
+			fast(INS::FSET, unary<FastOps::itof>);
+			fast(INS::IADD, selfBinary<FastOps::iadd>);
+			fast(INS::ISUB, selfBinary<FastOps::isub>);
+			fast(INS::IMUL, selfBinary<FastOps::imul>);
+			fast(INS::IDIV, selfBinary<FastOps::idiv>);
+			fast(INS::IMOD, selfBinary<FastOps::imod>);
+			fast(INS::IMOD2, selfBinary<FastOps::imod2>);
+			fast(INS::FADD, selfBinary<FastOps::fadd>);
+			fast(INS::FSUB, selfBinary<FastOps::fsub>);
+			fast(INS::FMUL, selfBinary<FastOps::fmul>);
+			fast(INS::FDIV, selfBinary<FastOps::fdiv>);
+			fast(INS::FMOD, selfBinary<FastOps::fmod>);
+			fast(INS::FMOD2, selfBinary<FastOps::fmod2>);
+			fast(INS::ISET_ADD, binary<FastOps::iadd>);
+			fast(INS::ISET_SUB, binary<FastOps::isub>);
+			fast(INS::ISET_MUL, binary<FastOps::imul>);
+			fast(INS::ISET_DIV, binary<FastOps::idiv>);
+			fast(INS::ISET_MOD, binary<FastOps::imod>);
+			fast(INS::FSET_ADD, binary<FastOps::fadd>);
+			fast(INS::FSET_SUB, binary<FastOps::fsub>);
+			fast(INS::FSET_MUL, binary<FastOps::fmul>);
+			fast(INS::FSET_DIV, binary<FastOps::fdiv>);
+			fast(INS::FSET_MOD, binary<FastOps::fmod>);
+			fast(INS::IINC, selfStep<FastOps::iadd>);
+			fast(INS::FINC, selfStep<FastOps::fadd>);
+			fast(INS::IDEC, selfStep<FastOps::isub>);
+			fast(INS::FDEC, selfStep<FastOps::fsub>);
+			fast(INS::FSET_SIN, unary<FastOps::sin>);
+			fast(INS::FSET_COS, unary<FastOps::cos>);
+			fast(INS::FSET_TAN, unary<FastOps::tan>);
+			fast(INS::FSET_ANGLE, angle);
+			fast(INS::NORMRAD, normRad);
+			fast(INS::MATHCIRCLEPOS, circlePos);
+			fast(INS::MATHDISTANCE, distance);
+			fast(INS::V2ADD, vec2<2>);
+			fast(INS::V2SCALE, vec2<2>);
+			fast(INS::V2ROTATE, vec2<2>);
+			fast(INS::V2POLAR_ADD, vec2<3>);
+			fast(INS::V2NORMALIZE, vec2<1>);
+			fast(INS::V2LENGTH, vec2<2>);
+			fast(INS::V2DOT, vec2<3>);
+			fast(INS::JMP_EQU, jmpIf<FastOps::equ, 2>);
+			fast(INS::JMP_EQU_F, jmpIf<FastOps::equ_f, 3>);
+			fast(INS::JMP_NEQ, jmpIf<FastOps::neq, 2>);
+			fast(INS::JMP_NEQ_F, jmpIf<FastOps::neq_f, 3>);
+			fast(INS::JMP_LT, jmpIf<FastOps::lt, 2>);
+			fast(INS::JMP_LT_F, jmpIf<FastOps::lt_f, 2>);
+			fast(INS::JMP_LTE, jmpIf<FastOps::lte, 2>);
+			fast(INS::JMP_LTE_F, jmpIf<FastOps::lte_f, 3>);
+			fast(INS::JMP_GT, jmpIf<FastOps::gt, 2>);
+			fast(INS::JMP_GT_F, jmpIf<FastOps::gt_f, 2>);
+			fast(INS::JMP_GTE, jmpIf<FastOps::gte, 2>);
+			fast(INS::JMP_GTE_F, jmpIf<FastOps::gte_f, 3>);
+			fast(INS::YEILD, yeild);
+		// spawns, PRINT, priority changes, and everything touching other routines stay in the interpreter.
+		default: return nullptr;
+		}
+
+#undef fast
+
+		// how many args the handler reads and which of them are ids it writes through come from the op table.
+		OpInfo const& op = OPS[ins.header.ins];
+		u32 argc = op.arity;
+		// too few args is an error the interpreter knows how to report. Extra ones are resolved (and RAND rolled) by the interpreter,
+		// so they'd go differently once the sub tiered up.
+		if (ins.args.size() != argc) return nullptr;
+
+		// the handlers check every id they write through before reading any value, so a deopt only has to be safe for the args up
+		// to the last id that's only known at runtime. Everything after it, RAND included, is read once through GetVar like the
+		// interpreter does.
+		auto isId = [&](u32 i) {
+			return op.operands[i] == OperandKind::DEST || op.operands[i] == OperandKind::INOUT || isVec2Arg(op.code, i)
+				|| (ins.header.ins == INS::MATHCIRCLEPOS && i == 1);
+		};
+		u32 deoptAfter = 0;
+		for (u32 i = 0; i < argc; i++) if (isId(i) && ins.args[i].type == AT::VTREF) deoptAfter = i + 1;
+
+		for (u32 i = 0; i < argc; i++) {
+			Arg const& arg = ins.args[i];
+			if (arg.type == AT::CNST) {
+				// a constant destination that points into another routine would always deopt.
+				if (isId(i) && ValPtr(arg.val).b) return nullptr;
+				continue;
+			}
+			if (arg.type != AT::VTREF) return nullptr;
+			// remote reads and vars that don't exist take the slow path so errors get reported the usual way.
+			if (ValPtr(arg.val).b || !tmpl.HasVar(arg.val)) return nullptr;
+			if (i < deoptAfter && !tmpl.IsCacheable(arg.val)) return nullptr;
+		}
+
+		return handler;
+	}
+
+	bool CompiledSub::ReachesOthers(Ins const& ins) {
+		OpInfo const* op = GetOp(ins.header.ins);
+		if (!op || op->has(OpFlags::REMOTE)) return true;
+		for (u32 i = 0; i < ins.args.size(); i++) {
+			Arg const& arg = ins.args[i];
+			if (arg.type == AT::VTREF && ValPtr(arg.val).b) return true;
+			bool isId = i < op->arity && (op->operands[i] == OperandKind::DEST || op->operands[i] == OperandKind::INOUT || isVec2Arg(op->code, i));
+			if (isId && (arg.type != AT::CNST || ValPtr(arg.val).b)) return true;
+		}
+		return false;
+	}
+
+	bool CompiledSub::IsLockstep(RoutineBase const& tmpl, Ins const& ins) {
+		if (ReachesOthers(ins)) return false;
+		OpInfo const& op = *GetOp(ins.header.ins);
+		if (op.flags & (OpFlags::STOPS | OpFlags::SPAWNS | OpFlags::RANDOM | OpFlags::OUTPUT | OpFlags::VM_STATE)) return false;
+		if (ins.args.size() != op.arity) return false;
+		for (Arg const& arg : ins.args) {
+			if (arg.type == AT::CNST) continue;
+			// RAND and friends draw from the rng when they're read.
+			if (arg.type != AT::VTREF || !tmpl.HasVar(arg.val) || !tmpl.IsCacheable(arg.val)) return false;
+		}
+		return true;
+	}
+
+	bool CompiledSub::UpdateLockstep(std::span<RoutineBase* const> group) const {
+		ZVM& vm = group.front()->vm;
+		std::optional<Value> diffopt = vm.GetVar(VTID::DIFF);
+		std::optional<Value> rankopt = vm.GetVar(VTID::RANK);
+		bool success = true;
+
+		enum : u8 { RUNNING, SPLIT, DONE };
+		std::vector<u8> state(group.size(), RUNNING);
+		// how many instructions each one executed before it was split off, so they count towards its budget when it finishes on its own.
+		std::vector<u32> spent(group.size(), 0);
+		// indices in group of the ones still running, in order.
+		std::vector<u32> running(group.size());
+		std::iota(running.begin(), running.end(), 0);
+		std::vector<RoutineBase*> lanes;
+		std::vector<RoutineBase*> rest;
+		LockstepOps::Scratch scratch;
+		auto finish = [&](u32 i) {
+			group[i]->KnownVar(VTID::TIME).u++;
+			group[i]->KnownVar(VTID::CLOCK).s++;
+			state[i] = DONE;
+		};
+
+		// every lane executes the same number of instructions, so they share the routine budget. The frame's is split between them.
+		const u32 budget = vm.RoutineBudget();
+		const u32 limit = min(budget, vm.FrameBudgetLeft() / static_cast<u32>(group.size()));
+		u32 steps = 0;
+		u64 executed = 0;
+
+		while (!running.empty()) {
+			RoutineBase& lead = *group[running.front()];
+			CompiledIns const* c_ins = Find(lead.ptr);
+			if (c_ins && lead.KnownVar(VTID::CLOCK).s < c_ins->header.time) {
+				for (u32 i : running) finish(i);
+				break;
+			}
+			if (steps == limit) {
+				for (u32 i : running) {
+					if (steps == budget) vm.OverBudget(*group[i], steps);
+					finish(i);
+				}
+				break;
+			}
+			if (!c_ins || !c_ins->lockstep) {
+				for (u32 i : running) {
+					state[i] = SPLIT;
+					spent[i] = steps;
+				}
+				break;
+			}
+			steps++;
+			executed += running.size();
+
+			InsHead const& header = c_ins->header;
+			bool masked = (diffopt && !(header.diff_mask & diffopt.value().s)) || (rankopt && !(header.rank_mask & rankopt.value().s));
+			lanes.clear();
+			for (u32 i : running) {
+				group[i]->nextPtr = c_ins->next;
+				lanes.push_back(group[i]);
+			}
+			rest.clear();
+			if (masked || !LockstepOps::run(*c_ins, lanes, scratch, rest)) rest.swap(lanes);
+
+			// the rest go through the same steps as in Routine::Update. They're in the same order as running.
+			usize next = 0;
+			for (u32 i : running) {
+				if (next == rest.size() || rest[next] != group[i]) continue;
+				RoutineBase& rt = *rest[next++];
+				Result result;
+				if (c_ins->fast && !masked) result = c_ins->fast(rt, *c_ins);
+				if (!result) {
+					std::optional<PrxIns> prx_ins = rt.ProcessArgs(header.ins, std::span(c_ins->args, header.arg_count));
+					// nothing happened yet, so Update can run it again and report it.
+					if (!prx_ins) {
+						state[i] = SPLIT;
+						spent[i] = steps - 1;
+						continue;
+					}
+					if (!masked) result = rt.Handle(prx_ins.value());
+				}
+				if (result && rt.Apply(result.value(), success)) {
+					rt.ptr = rt.nextPtr;
+					finish(i);
+				}
+			}
+
+			// whatever is still in step with the first one keeps going, the others are split off.
+			std::optional<std::pair<u32, i32>> at;
+			std::erase_if(running, [&](u32 i) {
+				if (state[i] != RUNNING) return true;
+				RoutineBase& rt = *group[i];
+				rt.ptr = rt.nextPtr;
+				std::pair<u32, i32> here{ rt.ptr, rt.KnownVar(VTID::CLOCK).s };
+				if (!at) at = here;
+				if (here == at) return false;
+				state[i] = SPLIT;
+				spent[i] = steps;
+				return true;
+			});
+		}
+
+		vm.ChargeFrame(executed);
+		for (u32 i = 0; i < group.size(); i++) {
+			if (state[i] == SPLIT && !group[i]->Update(spent[i])) success = false;
+		}
+		return success;
+	}
+}
\ No newline at end of file
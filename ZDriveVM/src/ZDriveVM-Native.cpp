@@ -0,0 +1,83 @@
+#include "ZDriveVM.hpp"
+
+namespace ZDrive::VM {
+	std::unique_ptr<Routine> RoutineNative::Clone(u32 newInstanceId) const {
+		std::unique_ptr<RoutineNative> clone = std::make_unique<RoutineNative>(*this);
+		(clone.get())->*(&RoutineNative::instanceId) = newInstanceId;
+		clone->ResetCloneState();
+		return clone;
+	}
+
+	bool RoutineNative::Update() {
+		// DIFF and RANK can't change while a routine is updating, so they're only looked up once.
+		diff = vm.GetVar(VTID::DIFF);
+		rank = vm.GetVar(VTID::RANK);
+
+		budget = vm.RoutineBudget();
+		limit = min(budget, vm.FrameBudgetLeft());
+		ticks = 0;
+
+		// the generated code stops at the same points the interpreter would, so it can pick up from wherever that is.
+		bool handled = fn(*this);
+		vm.ChargeFrame(ticks);
+		if (!handled) return Routine::Update(ticks);
+
+		KnownVar(VTID::TIME).u++;
+		KnownVar(VTID::CLOCK).s++;
+		return true;
+	}
+
+	bool RoutineNative::Tick() {
+		if (ticks < limit) {
+			ticks++;
+			return true;
+		}
+		if (ticks == budget) vm.OverBudget(*this, ticks);
+		return false;
+	}
+
+	bool RoutineNative::Loop(u32 pos, i32 t, u32 iterId) {
+		auto iterOpt = GetVar(iterId);
+		if (!iterOpt) {
+			Logger::Log(Logger::LL::Error) << "Could not find variable " << iterId;
+			return false;
+		}
+		Value iter = iterOpt.value();
+		if (!iter.u) return true;
+		OP_jmp(pos, t);
+		iter.u--;
+		if (SetVar(iterId, iter) == 2) {
+			Logger::Log(Logger::LL::Error) << "Variable " << iterId << " is read only.";
+			return false;
+		}
+		return true;
+	}
+
+	void RoutineNative::Check(bool success, u32 offset) {
+		if (success) return;
+		Logger::Log(Logger::LL::Error) << "Error while handling instruction: ";
+		Logger::Log(Logger::LL::Error) << Ins(code.begin() + offset).toString();
+	}
+
+	bool RoutineNative::Interpret(u32 offset) {
+		Ins ins(code.begin() + offset);
+		std::optional<PrxIns> prx_ins = ProcessInstruction(ins);
+		if (!prx_ins) {
+			Logger::Log(Logger::LL::Error) << "Skipping instruction that failed to process: ";
+			Logger::Log(Logger::LL::Error) << ins.toString();
+			return false;
+		}
+		if (!Runs(ins.header.diff_mask, ins.header.rank_mask)) return false;
+
+		HandleResult result = Handle(prx_ins.value());
+		deleteMe = result.deleteMe;
+		if (!result.success) {
+			Logger::Log(Logger::LL::Error) << "Error while handling instruction: ";
+			Logger::Log(Logger::LL::Error) << ins.toString();
+			if (result.deleteMe) {
+				Logger::Log(Logger::LL::Error) << "Routine {instance: " << instanceId << ", sub: " << subId << ", type: " << GetTypeID() << "} had a fatal error and will be terminated.";
+			}
+		}
+		return result.shouldReturn;
+	}
+}
\ No newline at end of file
@@ -12,23 +12,67 @@ namespace ZDrive::VM {
 
 	i32 Routine::SetVar(u32 id, Value val) {
 		ValPtr vptr = id;
-		return vptr.b ? vm.SetVarByPtr(vptr, val, *this) : IHasVarTable::SetVar(vptr.v, val);
+		if (!vptr.b) return IsWatched(vptr.v) ? SetWatchedVar(vptr.v, val) : IHasVarTable::SetVar(vptr.v, val);
+		// watched vars go the slow way, which ends up in SetWatchedVar on the owner.
+		if (RemoteSlotCache* cache = QuickenRemote(vptr); cache && !cache->read_only && !cache->owner->IsWatched(vptr.v)) {
+			*cache->slot = val;
+			return 0;
+		}
+		return vm.SetVarByPtr(vptr, val, *this);
+	}
+
+	i32 Routine::SetWatchedVar(u32 id, Value val) {
+		Value old = *FindVar(id);
+		i32 result = IHasVarTable::SetVar(id, val);
+		if (!result && old != val) vm.Wake(*this, id);
+		return result;
 	}
 
 	std::optional<Value> Routine::GetVar(u32 id) {
 		ValPtr vptr = id;
-		return vptr.b ? vm.GetVarByPtr(vptr, *this) : IHasVarTable::GetVar(vptr.v);
+		if (!vptr.b) return IHasVarTable::GetVar(vptr.v);
+		if (RemoteSlotCache* cache = QuickenRemote(vptr); cache) return *cache->slot;
+		return vm.GetVarByPtr(vptr, *this);
 	}
 
 	std::optional<std::reference_wrapper<Value>> Routine::GetVarRef(u32 id) {
 		ValPtr vptr = id;
-		return vptr.b ? vm.GetVarRefByPtr(vptr, *this) : IHasVarTable::GetVarRef(vptr.v);
+		if (!vptr.b) return IHasVarTable::GetVarRef(vptr.v);
+		if (RemoteSlotCache* cache = QuickenRemote(vptr); cache) return *cache->slot;
+		return vm.GetVarRefByPtr(vptr, *this);
+	}
+
+	Routine::RemoteSlotCache* Routine::QuickenRemote(ValPtr vptr) {
+		u32 target = vptr;
+		RemoteSlotCache& cache = remoteCache[(ptr ^ (target * 2654435761u)) % REMOTE_CACHE_SIZE];
+		if (cache.site == ptr && cache.target == target && cache.epoch == vm.GetRoutineEpoch()) return &cache;
+
+		// miss (or the guard failed): resolve the slot the slow way and requicken this site.
+		auto rt_optref = vm.GetRoutineByInstance(vptr.b, *this);
+		if (!rt_optref) return nullptr;
+		Routine& rt = rt_optref.value();
+		if (!rt.IsCacheable(vptr.v)) return nullptr;
+		Value* slot = rt.FindVar(vptr.v);
+		if (!slot) return nullptr;
+
+		cache.site = ptr;
+		cache.target = target;
+		cache.epoch = vm.GetRoutineEpoch();
+		cache.slot = slot;
+		cache.read_only = rt.IsReadOnly(vptr.v);
+		cache.owner = &rt;
+		return &cache;
 	}
 
 	std::optional<ProcessedInstruction> Routine::ProcessInstruction(Instruction const& ins) {
+		return ProcessArgs(ins.header.ins, ins.args);
+	}
+
+	std::optional<ProcessedInstruction> Routine::ProcessArgs(u32 opcode, std::span<const Arg> args) {
 		PrxIns ret;
-		ret.opcode = ins.header.ins;
-		for (Arg const& arg : ins.args) {
+		ret.opcode = opcode;
+		ret.args.reserve(args.size());
+		for (Arg const& arg : args) {
 			std::optional<Value> val = ResolveArg(arg);
 			if (val) {
 				ret.args.push_back(val.value());
@@ -50,6 +94,13 @@ namespace ZDrive::VM {
 		case AT::TEMP_LABEL:
 			Logger::Log(Logger::LL::Error) << "TEMP_LABEL ArgType in ResolveArg";
 			return std::nullopt;
+		case AT::TEMP_SUB:
+			Logger::Log(Logger::LL::Error) << "TEMP_SUB ArgType in ResolveArg";
+			return std::nullopt;
+		case AT::TEMP_VAR:
+		case AT::TEMP_VAR_REF:
+			Logger::Log(Logger::LL::Error) << "TEMP_VAR ArgType in ResolveArg";
+			return std::nullopt;
 		default:
 			Logger::Log(Logger::LL::Error) << "Unknown ArgType: " << arg.type;
 			return std::nullopt;
@@ -57,47 +108,79 @@ namespace ZDrive::VM {
 	}
 
 	bool Routine::Update() {
+		return Update(0u);
+	}
+
+	bool Routine::Update(u32 spent) {
 		bool handleSuccess = true;
 		Ins cur_ins;
-		VarTableVar& clock = vt[VTID::CLOCK];
+		Value& clock = KnownVar(VTID::CLOCK);
+		// the compiled tier is only ever built for RoutineBase templates.
+		CompiledSub const* compiled = vm.GetCompiledSub(subId);
+		// DIFF and RANK can't change while a routine is updating, so they're only looked up once.
+		std::optional<Value> diffopt = vm.GetVar(VTID::DIFF);
+		std::optional<Value> rankopt = vm.GetVar(VTID::RANK);
+		const u32 budget = vm.RoutineBudget();
+		// what was spent is already charged to the frame, so only what's left of the frame's budget goes on top.
+		u32 executed = min(spent, budget);
+		const u32 limit = executed + min(budget - executed, vm.FrameBudgetLeft());
+		spent = executed;
+
+		for (;;) {
+			CompiledSub::CompiledIns const* c_ins = compiled ? compiled->Find(ptr) : nullptr;
+			if (!c_ins) cur_ins = Ins(code.begin() + ptr);
+			InsHead const& header = c_ins ? c_ins->header : cur_ins.header;
+			if (clock.s < header.time) break;
+			// running into the frame's budget just stops it here for this frame, it's only the routine's own that's reported.
+			if (executed == limit) {
+				if (executed == budget) vm.OverBudget(*this, executed);
+				break;
+			}
 
-		while (cur_ins = Ins(code.begin() + ptr), clock.val.s >= cur_ins.header.time) {
-			nextPtr = ptr + static_cast<u32>(cur_ins.size());
+			nextPtr = c_ins ? c_ins->next : ptr + static_cast<u32>(cur_ins.size());
+			executed++;
 			bool shouldReturn = false;
-			std::optional<PrxIns> prx_ins = ProcessInstruction(cur_ins);
-			if (!prx_ins) {
-				Logger::Log(Logger::LL::Error) << "Skipping instruction that failed to process: ";
-				Logger::Log(Logger::LL::Error) << cur_ins.toString();
-			} else {
-				i32 diff_mask = cur_ins.header.diff_mask;
-				i32 rank_mask = cur_ins.header.rank_mask;
-				std::optional<Value> diffopt = vm.GetVar(VTID::DIFF);
-				std::optional<Value> rankopt = vm.GetVar(VTID::RANK);
-				if ((!diffopt || diff_mask & diffopt.value().s) &&
-					(!rankopt || rank_mask & rankopt.value().s)) {
-					HandleResult result = Handle(prx_ins.value());
-					handleSuccess |= result.success;
-					shouldReturn = result.shouldReturn;
-					deleteMe = result.deleteMe;
-
-					if (!result.success) {
-						Logger::Log(Logger::LL::Error) << "Error while handling instruction: ";
-						Logger::Log(Logger::LL::Error) << cur_ins.toString();
-						if (result.deleteMe) {
-							Logger::Log(Logger::LL::Error) << "Routine {instance: " << instanceId << ", sub: " << subId << ", type: " << GetTypeID() << "} had a fatal error and will be terminated.";
-						}
-					}
+			bool masked = (diffopt && !(header.diff_mask & diffopt.value().s)) || (rankopt && !(header.rank_mask & rankopt.value().s));
+			auto insString = [&]() { return c_ins ? Ins(code.begin() + ptr).toString() : cur_ins.toString(); };
+
+			std::optional<HandleResult> result;
+			if (c_ins && c_ins->fast && !masked) result = c_ins->fast(static_cast<RoutineBase&>(*this), *c_ins);
+			if (!result) {
+				std::optional<PrxIns> prx_ins = c_ins ? ProcessArgs(header.ins, std::span(c_ins->args, header.arg_count)) : ProcessInstruction(cur_ins);
+				if (!prx_ins) {
+					Logger::Log(Logger::LL::Error) << "Skipping instruction that failed to process: ";
+					Logger::Log(Logger::LL::Error) << insString();
+				} else if (!masked) {
+					result = Handle(prx_ins.value());
 				}
 			}
+
+			if (result) shouldReturn = Apply(result.value(), handleSuccess);
 			ptr = nextPtr;
 			if (shouldReturn) break;
 		}
-		vt[VTID::TIME].val.u++;
-		clock.val.s++;
+		KnownVar(VTID::TIME).u++;
+		clock.s++;
+		vm.ChargeFrame(executed - spent);
+		vm.CountExecution(subId, executed - spent);
 
 		return handleSuccess;
 	}
 
+	bool Routine::Apply(HandleResult const& result, bool& handleSuccess) {
+		handleSuccess |= result.success;
+		deleteMe = result.deleteMe;
+
+		if (!result.success) {
+			Logger::Log(Logger::LL::Error) << "Error while handling instruction: ";
+			Logger::Log(Logger::LL::Error) << Ins(code.begin() + ptr).toString();
+			if (result.deleteMe) {
+				Logger::Log(Logger::LL::Error) << "Routine {instance: " << instanceId << ", sub: " << subId << ", type: " << GetTypeID() << "} had a fatal error and will be terminated.";
+			}
+		}
+		return result.shouldReturn;
+	}
+
 	i32 Routine::try_set(u32 id, Value const& value) {
 		i32 result = SetVar(id, value);
 		if (result == 1) {
@@ -223,9 +306,9 @@ namespace ZDrive::VM {
 	const std::function<Value(Value, Value)> RoutineBase::func_fdiv = [](Value a, Value b) { return a.f / b.f; };
 	const std::function<Value(Value, Value)> RoutineBase::func_fmod = [](Value a, Value b) { return fmodf(a, b); };
 	const std::function<Value(Value, Value)> RoutineBase::func_fmod2 = [](Value a, Value b) { return fmodf(b, a); };
-	const std::function<Value(Value)> RoutineBase::func_sin = [](Value a) { return sinf(a); };
-	const std::function<Value(Value)> RoutineBase::func_cos = [](Value a) { return cosf(a); };
-	const std::function<Value(Value)> RoutineBase::func_tan = [](Value a) { return tanf(a); };
+	const std::function<Value(Value)> RoutineBase::func_sin = [](Value a) { return Math::sin(a); };
+	const std::function<Value(Value)> RoutineBase::func_cos = [](Value a) { return Math::cos(a); };
+	const std::function<Value(Value)> RoutineBase::func_tan = [](Value a) { return Math::tan(a); };
 
 
 	std::optional<Value> RoutineBase::GetVar(u32 id) {
@@ -239,8 +322,9 @@ namespace ZDrive::VM {
 	}
 
 	std::unique_ptr<Routine> RoutineBase::Clone(u32 newInstanceId) const {
-		std::unique_ptr<Routine> clone = std::make_unique<RoutineBase>(*this);
+		std::unique_ptr<RoutineBase> clone = std::make_unique<RoutineBase>(*this);
 		(clone.get())->*(&RoutineBase::instanceId) = newInstanceId;
+		clone->ResetCloneState();
 		return clone;
 	}
 
@@ -248,7 +332,7 @@ namespace ZDrive::VM {
 		HandleResult ret{true, false, false};
 		u32 opcode = ins.opcode;
 		std::vector<Value> const& args = ins.args;
-		Value& clock = vt[VTID::CLOCK].val;
+		Value& clock = KnownVar(VTID::CLOCK);
 
 		try {
 			switch (opcode) {
@@ -316,7 +400,7 @@ namespace ZDrive::VM {
 				f32 y1 = args.at(2);
 				f32 x2 = args.at(3);
 				f32 y2 = args.at(4);
-				ret.success = !try_set(id, atan2f(y1 - y2, x1 - x2));
+				ret.success = !try_set(id, Math::atan2(y1 - y2, x1 - x2));
 				break;
 			}
 			case INS::FINTERP: {
@@ -328,39 +412,28 @@ namespace ZDrive::VM {
 				f32 f1 = args.at(5);
 				f32 f2 = args.at(6);
 
-				auto interp_optref = vm.CloneAndActivateTemplate(DEF_SUB::INTERP_LINEAR + m);
-				if (interp_optref) {
-					Routine& interp_rt = interp_optref.value();
-					// dumb hack because i think protected methods should be accessible through their objects within derived classes
-					// ret.success &= !interp_rt.try_set(VTID::IN0, ValPtr(instanceId, id)); // Error: protected function is not accessible through member or pointer
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN0, ValPtr(instanceId, id));
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN1, t);
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN2, m);
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN3, start);
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN4, end);
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN5, f1);
-					ret.success &= !(interp_rt.*(&RoutineBase::try_set))(VTID::IN6, f2);
-				} else {
+				std::array<Value, 7> interpArgs{ ValPtr(instanceId, id), t, m, start, end, f1, f2 };
+				if (!vm.CloneAndActivateTemplate(DEF_SUB::INTERP_LINEAR + m, this, interpArgs)) {
 					Logger::Log(Logger::LL::Error) << "Could not find routine with subId " << DEF_SUB::INTERP_LINEAR + m << "in templates.";
 					ret.success = false;
 				}
 				break;
 			}
-			case INS::NORMRAD: ret.success = !self_unary_op(args.at(0), [](Value a) { return remainderf(a, static_cast<f32>(M_PI*2)); }); break;
+			case INS::NORMRAD: ret.success = !self_unary_op(args.at(0), [](Value a) { return Math::normRad(a); }); break;
 			case INS::MATHCIRCLEPOS: {
 				u32 idX = args.at(0);
 				u32 idY = args.at(1);
 				f32 r = args.at(2);
 				f32 theta = args.at(3);
-				ret.success &= !try_set(idX, r*cosf(theta));
-				ret.success &= !try_set(idY, r*sinf(theta));
+				ret.success &= !try_set(idX, r*Math::cos(theta));
+				ret.success &= !try_set(idY, r*Math::sin(theta));
 				break;
 			}
 			case INS::MATHDISTANCE: {
 				u32 id = args.at(0);
 				f32 dx = args.at(3).f - args.at(1).f;
 				f32 dy = args.at(4).f - args.at(2).f;
-				ret.success = !try_set(id, sqrtf(dx*dx + dy*dy));
+				ret.success = !try_set(id, Math::sqrt(dx*dx + dy*dy));
 				break;
 			}
 			case INS::JMP_EQU: if (args.at(2) == args.at(3)) OP_jmp(args.at(0), args.at(1)); break;
@@ -375,14 +448,7 @@ namespace ZDrive::VM {
 			case INS::JMP_GT_F: if (args.at(2).f > args.at(3).f) OP_jmp(args.at(0), args.at(1)); break;
 			case INS::JMP_GTE: if (args.at(2).s >= args.at(3).s) OP_jmp(args.at(0), args.at(1)); break;
 			case INS::JMP_GTE_F: if (args.at(2).f >= args.at(3).f - copysignf(args.at(4), args.at(3))) OP_jmp(args.at(0), args.at(1)); break;
-			case INS::CALL: {
-				auto rt_optref = vm.CloneAndActivateTemplate(args.at(0));
-				if (!rt_optref) {
-					Logger::Log(Logger::LL::Error) << "Could not find routine with subId " << args.at(0).u << "in templates.";
-					ret.success = false;
-				}
-				break;
-			}
+			case INS::CALL: ret.success = OP_call(args.at(0)); break;
 			case INS::YEILD: ret.shouldReturn = true; break;
 			case INS::PRINT: {
 				Logger::LogLevel level = static_cast<Logger::LogLevel>(args.at(0).s);
@@ -398,12 +464,131 @@ namespace ZDrive::VM {
 					ret.success = !try_set(resultId, 1);
 				} else {
 					Routine& rt = rt_optref.value();
-					bool target_has = (rt.*(&RoutineBase::vt)).contains(test.v);
+					bool target_has = rt.HasVar(test.v);
 					ret.success = !try_set(resultId, target_has ? 0 : 2);
 				}
 				break;
 			}
 			case INS::SET_PRIORITY: vm.UpdatePriority(instanceId, args.at(0)); break;
+			case INS::SET_GROUP: vm.SetGroup(*this, args.at(0)); break;
+			case INS::KILL_GROUP:
+			case INS::SUSPEND_GROUP: {
+				u32 target = args.at(0);
+				// killing takes it out of the group, so this is checked first.
+				bool inTarget = target && target == group;
+				if (opcode == INS::KILL_GROUP) vm.KillGroup(target);
+				else vm.SuspendGroup(target);
+				// if it's in the group itself, it stops here.
+				if (inTarget) {
+					ret.shouldReturn = true;
+					ret.deleteMe = opcode == INS::KILL_GROUP;
+				}
+				break;
+			}
+			case INS::RESUME_GROUP: vm.ResumeGroup(args.at(0)); break;
+			case INS::SET_GROUP_PRIORITY: vm.SetGroupPriority(args.at(0), args.at(1)); break;
+			case INS::SET_DEFERRABLE: deferrable = args.at(0).s != 0; break;
+			case INS::CALL_ARGS: {
+				u32 subId = args.at(0);
+				std::span<const Value> callArgs = std::span(args).subspan(1, min(args.size() - 1, static_cast<usize>(8)));
+				// OUTs are still written so it does the same as the sets it was fused from, in case anything reads them later.
+				for (u32 i = 0; i < callArgs.size(); i++) ret.success &= !try_set(VTID::OUT0 + i, callArgs[i]);
+				ret.success &= OP_call(subId, callArgs);
+				break;
+			}
+			case INS::DEC_JMP: {
+				u32 id = args.at(0);
+				u32 cmp = args.at(1);
+				u32 pos = args.at(2);
+				i32 t = args.at(3);
+				Value rhs = args.at(4);
+				ret.success = !self_binary_op(id, 1, func_isub);
+				// the jump reads the var after it was decremented, same as the separate instructions would.
+				auto lhs = GetVar(id);
+				if (!lhs) {
+					Logger::Log(Logger::LL::Error) << "Could not resolve argument $" << id << ": variable not found.";
+					break;
+				}
+				// only the int comparisons, the float ones are every other opcode from JMP_EQU_F.
+				bool isInt = (cmp - INS::JMP_EQU) % 2 == 0;
+				std::optional<bool> jump = isInt ? jumpTaken(cmp, lhs.value(), rhs, 0) : std::nullopt;
+				if (!jump) {
+					Logger::Log(Logger::LL::Error) << "DEC_JMP with invalid comparison " << cmp;
+					ret.success = false;
+				} else if (jump.value()) {
+					OP_jmp(pos, t);
+				}
+				break;
+			}
+			case INS::WAIT_CHANGE: {
+				u32 id = args.at(0);
+				auto val = GetVar(id);
+				if (!val) {
+					Logger::Log(Logger::LL::Error) << "Could not resolve argument $" << id << ": variable not found.";
+					ret.success = false;
+					break;
+				}
+				if (waitFrom && waitFrom.value() != val.value()) {
+					waitFrom.reset();
+					break;
+				}
+				if (!waitFrom) waitFrom = val;
+				// it runs again once it's woken (or next frame, if the var can't be waited on) to see if it changed.
+				nextPtr = ptr;
+				ret.shouldReturn = true;
+				vm.Block(*this, std::span(&id, 1));
+				break;
+			}
+			case INS::WAIT_UNTIL: {
+				std::optional<bool> wait = jumpTaken(args.at(2), args.at(3), args.at(4), args.at(5));
+				if (!wait) {
+					Logger::Log(Logger::LL::Error) << "WAIT_UNTIL with invalid comparison " << args.at(2).u;
+					ret.success = false;
+					break;
+				}
+				if (!wait.value()) break;
+				// the condition is worked out again from where the jump goes when it's woken.
+				OP_jmp(args.at(0), args.at(1));
+				ret.shouldReturn = true;
+				std::vector<u32> ids(args.begin() + 6, args.end());
+				vm.Block(*this, ids);
+				break;
+			}
+			case INS::EMIT_RING:
+			case INS::EMIT_FAN:
+			case INS::EMIT_SPREAD:
+			case INS::EMIT_AIMED: ret.success = OP_emit(opcode, args); break;
+			case INS::V2ADD:
+			case INS::V2SCALE:
+			case INS::V2ROTATE:
+			case INS::V2POLAR_ADD:
+			case INS::V2NORMALIZE:
+			case INS::V2LENGTH:
+			case INS::V2DOT: {
+				std::array<Value, 3> vals{};
+				for (u32 i = 0; i < OPS[opcode].arity; i++) vals[i] = args.at(i);
+				ret.success = OP_vec2(opcode, vals);
+				break;
+			}
+			case INS::CIRCLEPOS_ADD: {
+				u32 idX = args.at(0);
+				u32 idY = args.at(1);
+				f32 r = args.at(2);
+				f32 theta = args.at(3);
+				u32 posX = args.at(4);
+				u32 posY = args.at(5);
+				ret.success &= !try_set(idX, r*Math::cos(theta));
+				ret.success &= !try_set(idY, r*Math::sin(theta));
+				for (auto [pos, id] : { std::pair{posX, idX}, std::pair{posY, idY} }) {
+					auto val = GetVar(id);
+					if (!val) {
+						Logger::Log(Logger::LL::Error) << "Could not resolve argument $" << id << ": variable not found.";
+						continue;
+					}
+					ret.success &= !self_binary_op(pos, val.value(), func_fadd);
+				}
+				break;
+			}
 			}
 		} catch (std::out_of_range oor) {
 			Logger::Log(Logger::LL::Error) << "Fatal error on {instance: " << instanceId << ", sub: " << subId << ", type: " << GetTypeID() << "}:";
@@ -415,9 +600,132 @@ namespace ZDrive::VM {
 		return ret;
 	}
 
+	std::optional<bool> RoutineBase::jumpTaken(u32 jmpOpcode, Value lhs, Value rhs, Value eps) {
+		switch (jmpOpcode) {
+		case INS::JMP_EQU: return lhs == rhs;
+		case INS::JMP_EQU_F: return fabsf(lhs.f - rhs.f) < fabsf(eps);
+		case INS::JMP_NEQ: return lhs != rhs;
+		case INS::JMP_NEQ_F: return fabsf(lhs.f - rhs.f) > fabsf(eps);
+		case INS::JMP_LT: return lhs.s < rhs.s;
+		case INS::JMP_LT_F: return lhs.f < rhs.f;
+		case INS::JMP_LTE: return lhs.s <= rhs.s;
+		case INS::JMP_LTE_F: return lhs.f <= rhs.f + copysignf(eps, rhs);
+		case INS::JMP_GT: return lhs.s > rhs.s;
+		case INS::JMP_GT_F: return lhs.f > rhs.f;
+		case INS::JMP_GTE: return lhs.s >= rhs.s;
+		case INS::JMP_GTE_F: return lhs.f >= rhs.f - copysignf(eps, rhs);
+		}
+		return std::nullopt;
+	}
+
 	void RoutineBase::OP_jmp(u32 pos, i32 t) {
 		nextPtr = pos; 
-		vt[VTID::CLOCK].val = t;
+		KnownVar(VTID::CLOCK) = t;
 	}
 
+	bool RoutineBase::OP_call(u32 subId, std::span<const Value> args) {
+		auto rt_optref = vm.CloneAndActivateTemplate(subId, this, args);
+		if (!rt_optref) {
+			Logger::Log(Logger::LL::Error) << "Could not find routine with subId " << subId << "in templates.";
+			return false;
+		}
+		return true;
+	}
+
+	bool RoutineBase::OP_emit(u32 opcode, std::vector<Value> const& args) {
+		u32 subId = args.at(0);
+		i32 count = args.at(1);
+		if (count < 0) {
+			Logger::Log(Logger::LL::Error) << "Tried to emit " << count << " routines.";
+			return false;
+		}
+		if (count == 0) return true;
+		if (count > MAX_EMIT) {
+			Logger::Log(Logger::LL::Warn) << "Tried to emit " << count << " routines at once, only emitting " << MAX_EMIT << ".";
+			count = MAX_EMIT;
+		}
+		// the last of its own args, not of however many the instruction has.
+		f32 speed = args.at(OPS[opcode].arity - 1);
+		f32 centre = opcode == INS::EMIT_AIMED ? Math::atan2(args.at(3), args.at(2)) : args.at(2).f;
+		f32 arc = opcode == INS::EMIT_AIMED ? args.at(4).f : opcode == INS::EMIT_RING ? 0 : args.at(3).f;
+
+		// <index, angle, speed> of each, in that order.
+		std::vector<Value> emitArgs;
+		emitArgs.reserve(static_cast<usize>(count) * 3);
+		for (i32 i = 0; i < count; i++) {
+			f32 angle = centre;
+			switch (opcode) {
+			case INS::EMIT_RING: angle += static_cast<f32>(M_PI * 2) * i / count; break;
+			case INS::EMIT_SPREAD: angle += arc * (ZDrive::randf() - 0.5f); break;
+			default: if (count > 1) angle += arc * (static_cast<f32>(i) / (count - 1) - 0.5f);
+			}
+			emitArgs.insert(emitArgs.end(), { i, angle, speed });
+		}
+
+		if (!vm.CloneAndActivateTemplates(subId, this, count, emitArgs)) {
+			Logger::Log(Logger::LL::Error) << "Could not find routine with subId " << subId << "in templates.";
+			return false;
+		}
+		return true;
+	}
+
+	bool RoutineBase::OP_vec2(u32 opcode, std::array<Value, 3> const& args) {
+		// x and y of the vector starting at id.
+		auto get = [this](u32 id) -> std::optional<std::pair<f32, f32>> {
+			std::optional<Value> x = GetVar(id);
+			std::optional<Value> y = GetVar(id + 1);
+			if (!x || !y) {
+				Logger::Log(Logger::LL::Error) << "Could not find variable " << (x ? id + 1 : id);
+				return std::nullopt;
+			}
+			return std::pair<f32, f32>{ x.value(), y.value() };
+		};
+
+		if (opcode == INS::V2LENGTH || opcode == INS::V2DOT) {
+			auto a = get(args[1]);
+			auto b = opcode == INS::V2DOT ? get(args[2]) : a;
+			if (!a || !b) return false;
+			f32 dot = a->first * b->first + a->second * b->second;
+			return !try_set(args[0], opcode == INS::V2LENGTH ? Math::sqrt(dot) : dot);
+		}
+
+		u32 id = args[0];
+		auto v = get(id);
+		if (!v) return false;
+		auto [x, y] = v.value();
+		switch (opcode) {
+		case INS::V2ADD: {
+			auto b = get(args[1]);
+			if (!b) return false;
+			x += b->first;
+			y += b->second;
+			break;
+		}
+		case INS::V2SCALE:
+			x *= args[1].f;
+			y *= args[1].f;
+			break;
+		case INS::V2ROTATE: {
+			f32 c = Math::cos(args[1]);
+			f32 s = Math::sin(args[1]);
+			f32 rx = x * c - y * s;
+			y = x * s + y * c;
+			x = rx;
+			break;
+		}
+		case INS::V2POLAR_ADD:
+			x += args[1].f * Math::cos(args[2]);
+			y += args[1].f * Math::sin(args[2]);
+			break;
+		case INS::V2NORMALIZE: {
+			f32 length = Math::sqrt(x * x + y * y);
+			if (length > 0) {
+				x /= length;
+				y /= length;
+			}
+			break;
+		}
+		}
+		return !try_set(id, x) && !try_set(id + 1, y);
+	}
 }
\ No newline at end of file
@@ -1,34 +1,65 @@
 #include "ZDriveVM.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
 namespace ZDrive::VM {
 
-	ZVM::ZVM(std::vector<i32>&& _code, std::vector<i32>& results) : code(std::move(_code)) {
+	ZVM::ZVM(std::vector<i32>&& _code, std::vector<i32>& results, ZVMOptions const& options) : code(std::move(_code)), options(options), commands(options.commandQueueCapacity) {
+		auto startTime = std::chrono::steady_clock::now();
 		InitializeDefVars();
 
 		u32 rt_count = code[0];
 		u32 mainId = code[1];
 
-		for (u32 i = 0; i < rt_count; i++) {
-			u32 typeId = code[i * 3 + 2];
-			u32 size = code[i * 3 + 3];
-			u32 start = code[i * 3 + 4];
+		templates.resize(rt_count);
+		templateBuilt.resize(rt_count);
+		compiledSubs.resize(rt_count);
+		execCounts.resize(rt_count);
+		startupReport.templateCount = rt_count;
 
-			Routine* rt_ptr = nullptr;
-			
-			switch (typeId) {
-			default:
-				Logger::Log(Logger::LL::Error) << "Error creating routine template for routine id " << i << ": type " << typeId << " not recognized.";
-				results.push_back(1);
-				[[fallthrough]];
-			case RT::BASE: rt_ptr = new RoutineBase(*this, std::span(code.begin() + start, size), i, 0); break;
+		if (options.templateLoading != TemplateLoading::LAZY) {
+			u32 threads = 1;
+			if (options.templateLoading == TemplateLoading::PARALLEL) {
+				threads = options.loadThreads ? options.loadThreads : max(std::thread::hardware_concurrency(), 1u);
+				// threads aren't worth starting for a handful of templates.
+				threads = max(min(threads, rt_count / 64), 1u);
 			}
+			startupReport.threads = threads;
 
-			rt_ptr->Update();
-			if (rt_ptr->deleteMe) {
-				Logger::Log(Logger::LL::Error) << "Template for routine id " << i << " marked for deletion after construction. It will not be constructable.";
-				delete rt_ptr;
+			if (threads == 1) {
+				for (u32 i = 0; i < rt_count; i++) FinishTemplate(i, BuildTemplate(i, results, startupReport));
 			} else {
-				templates.emplace_back(rt_ptr);
+				// each template's log and results are held back and merged in order of ids, so they don't depend on which thread got there first.
+				std::vector<std::unique_ptr<Routine>> built(rt_count);
+				std::vector<std::vector<i32>> builtResults(rt_count);
+				std::vector<std::ostringstream> logs(rt_count);
+				std::vector<ZVMStartupReport> reports(threads);
+				std::atomic<u32> next = 0;
+				auto work = [&](u32 thread) {
+					for (u32 i; (i = next++) < rt_count; ) {
+						Logger::SetThreadOutput(&logs[i]);
+						built[i] = BuildTemplate(i, builtResults[i], reports[thread]);
+					}
+					Logger::SetThreadOutput(nullptr);
+				};
+
+				std::vector<std::thread> workers;
+				workers.reserve(threads);
+				for (u32 i = 0; i < threads; i++) workers.emplace_back(work, i);
+				for (std::thread& worker : workers) worker.join();
+
+				for (ZVMStartupReport const& report : reports) {
+					startupReport.constructTime += report.constructTime;
+					startupReport.verifyTime += report.verifyTime;
+				}
+				for (u32 i = 0; i < rt_count; i++) {
+					Logger::Write(logs[i].str());
+					results.insert(results.end(), builtResults[i].begin(), builtResults[i].end());
+					FinishTemplate(i, std::move(built[i]));
+				}
 			}
 		}
 
@@ -42,16 +73,117 @@ namespace ZDrive::VM {
 				finished = true;
 				results.push_back(3);
 			} else {
+				// so the entry sub's problems still make it into results.
+				if (mainId < rt_count && !templateBuilt[mainId]) FinishTemplate(mainId, BuildTemplate(mainId, results, startupReport));
 				auto res = CloneAndActivateTemplate(mainId);
 				if (!res) results.push_back(4);
 			}
 		}
+
+		startupReport.totalTime = std::chrono::duration<f64>(std::chrono::steady_clock::now() - startTime).count();
+		Logger::Log(Logger::LL::Debug) << std::format("Loaded {}/{} templates in {:.2f} ms on {} threads: construct {:.2f} ms, verify {:.2f} ms, update {:.2f} ms.",
+			startupReport.templatesBuilt, rt_count, startupReport.totalTime * 1000, startupReport.threads,
+			startupReport.constructTime * 1000, startupReport.verifyTime * 1000, startupReport.updateTime * 1000);
+	}
+
+	std::unique_ptr<Routine> ZVM::BuildTemplate(u32 subId, std::vector<i32>& results, ZVMStartupReport& report) {
+		u32 typeId = code[subId * 3 + 2];
+		u32 size = code[subId * 3 + 3];
+		u32 start = code[subId * 3 + 4];
+
+		std::unique_ptr<Routine> rt_ptr;
+		auto t0 = std::chrono::steady_clock::now();
+		switch (typeId) {
+		default:
+			Logger::Log(Logger::LL::Error) << "Error creating routine template for routine id " << subId << ": type " << typeId << " not recognized.";
+			results.push_back(1);
+			[[fallthrough]];
+		case RT::BASE: {
+			std::span<const i32> sub(code.begin() + start, size);
+			if (!VerifyTemplate(subId, sub)) results.push_back(5);
+			auto t1 = std::chrono::steady_clock::now();
+			report.verifyTime += std::chrono::duration<f64>(t1 - t0).count();
+			t0 = t1;
+			if (NativeSub::Fn fn = FindNativeSub(subId, sub)) rt_ptr = std::make_unique<RoutineNative>(*this, sub, subId, 0, fn);
+			else rt_ptr = std::make_unique<RoutineBase>(*this, sub, subId, 0);
+			break;
+		}
+		}
+		report.constructTime += std::chrono::duration<f64>(std::chrono::steady_clock::now() - t0).count();
+		return rt_ptr;
+	}
+
+	void ZVM::FinishTemplate(u32 subId, std::unique_ptr<Routine> rt) {
+		auto t0 = std::chrono::steady_clock::now();
+		templateBuilt[subId] = true;
+		startupReport.templatesBuilt++;
+		rt->Update();
+		if (rt->deleteMe) {
+			Logger::Log(Logger::LL::Error) << "Template for routine id " << subId << " marked for deletion after construction. It will not be constructable.";
+		} else {
+			templates[subId] = std::move(rt);
+		}
+		startupReport.updateTime += std::chrono::duration<f64>(std::chrono::steady_clock::now() - t0).count();
+	}
+
+	Routine* ZVM::GetTemplate(u32 subId) {
+		if (subId >= templates.size()) return nullptr;
+		if (!templateBuilt[subId]) {
+			std::vector<i32> results;
+			FinishTemplate(subId, BuildTemplate(subId, results, startupReport));
+		}
+		return templates[subId].get();
 	}
 
 	ZVM::~ZVM() {}
 
+	bool ZVM::VerifyTemplate(u32 subId, std::span<const i32> sub) const {
+		bool ok = true;
+		std::unordered_set<u32> starts;
+		std::vector<std::pair<u32, u32>> jumps; // <offset of the jump, where it goes>
+		u32 offset = 0;
+		while (offset < sub.size()) {
+			if (offset + INS_HEADER_SIZE > sub.size()) {
+				Logger::Log(Logger::LL::Warn) << std::format("Template {}: instruction at {} is cut off by the end of the routine.", subId, offset);
+				return false;
+			}
+			u32 opcode = sub[offset + INS_CODE];
+			u32 argc = sub[offset + INS_ARGCOUNT];
+			if (offset + INS_HEADER_SIZE + static_cast<usize>(argc) * 2 > sub.size()) {
+				Logger::Log(Logger::LL::Warn) << std::format("Template {}: args of instruction at {} are cut off by the end of the routine.", subId, offset);
+				return false;
+			}
+			starts.insert(offset);
+
+			if (OpInfo const* op = GetOp(opcode)) {
+				if (argc < op->arity) {
+					Logger::Log(Logger::LL::Warn) << std::format("Template {}: {} at {} has {} args but needs {}.", subId, op->name, offset, argc, static_cast<u32>(op->arity));
+					ok = false;
+				} else if (auto pos = op->operand(OperandKind::POS); pos && sub[offset + INS_HEADER_SIZE + pos.value() * 2] == AT::CNST) {
+					jumps.emplace_back(offset, sub[offset + INS_HEADER_SIZE + pos.value() * 2 + 1]);
+				}
+			} else {
+				Logger::Log(Logger::LL::Warn) << std::format("Template {}: unknown opcode {} at {}.", subId, opcode, offset);
+				ok = false;
+			}
+			offset += INS_HEADER_SIZE + argc * 2;
+		}
+
+		// jumping to the very end just ends the routine.
+		starts.insert(offset);
+		for (auto const& [from, to] : jumps) {
+			if (starts.contains(to)) continue;
+			Logger::Log(Logger::LL::Warn) << std::format("Template {}: jump at {} goes to {}, which isn't the start of an instruction.", subId, from, to);
+			ok = false;
+		}
+		return ok;
+	}
+
 	bool ZVM::Update() {
 		bool ret = true;
+		auto startTime = std::chrono::steady_clock::now();
+		frameReport = {};
+		ApplyCommands();
 
 		if (active.size() == 0) {
 			if (finished == true)
@@ -63,27 +195,198 @@ namespace ZDrive::VM {
 			Logger::Log(Logger::LL::Info) << "The ZVM has finished running.";
 		}
 
+		const u32 frame = KnownVar(VTID::TIME).u;
+		frameExecuted = 0;
+		// only deferrable routines look at the clock, and once the frame is late it stays that way, so it isn't read again.
+		bool late = false;
+		auto update = [&](Routine& rt) {
+			CatchUp(rt, frame);
+			rt.deferredFor = 0;
+			frameReport.updated++;
+			if (!rt.Update()) {
+				Logger::Log(Logger::LL::Error) << "Error updating routine " << rt.toString();
+				ret = false;
+			}
+		};
 		for (auto&& iter = active.begin(); iter != active.end(); ) {
 			std::unique_ptr<Routine> const& rt_ptr = *iter;
 			if (rt_ptr->deleteMe) {
+				// whatever waits on it gets to find out it's gone.
+				while (!rt_ptr->waiters.empty()) Unblock(*rt_ptr->waiters.back().second);
+				if (rt_ptr->blocked) Unblock(*rt_ptr);
+				UnlinkGroup(*rt_ptr);
 				iter = active.erase(iter);
+				routineEpoch++;
+			} else if (rt_ptr->blocked || rt_ptr->suspended) {
+				iter++;
+			} else if (FrameBudgetLeft() == 0) {
+				// the rest wait for the next frame, but dead ones still get cleaned up.
+				frameReport.skipped++;
+				iter++;
+			} else if (CanDefer(*rt_ptr)) {
+				if (!late) late = std::chrono::duration<f64>(std::chrono::steady_clock::now() - startTime).count() > options.frameTimeBudget;
+				if (late && rt_ptr->deferredFor < options.maxDeferFrames) {
+					rt_ptr->deferredFor++;
+					frameReport.deferred++;
+				} else {
+					update(*rt_ptr);
+				}
+				iter++;
 			} else {
-				if (!rt_ptr->Update()) {
-					Logger::Log(Logger::LL::Error) << "Error updating routine " << rt_ptr->toString();
-					ret = false;
+				CatchUp(*rt_ptr, frame);
+				if (auto next = UpdateLockstep(iter, frame, ret); next != iter) {
+					iter = next;
+					continue;
 				}
+				update(*rt_ptr);
 				iter++;
 			}
 		}
 
+		if (frameReport.skipped) {
+			Logger::Log(Logger::LL::Debug) << "The frame's instruction budget of " << options.frameInstructionBudget << " ran out, " << frameReport.skipped << " routines weren't updated.";
+		}
+		if (frameReport.deferred) {
+			Logger::Log(Logger::LL::Debug) << "The frame went over its time budget, " << frameReport.deferred << " routines were put off.";
+		}
+
 		if (toBeResorted.size()) {
 			ResortActive();
 		}
 
-		vt[VTID::TIME].val.u++;
+		KnownVar(VTID::TIME).u++;
+		if (options.snapshots) {
+			auto snapshotStart = std::chrono::steady_clock::now();
+			TakeSnapshot();
+			frameReport.snapshotTime = std::chrono::duration<f64>(std::chrono::steady_clock::now() - snapshotStart).count();
+		}
+		frameReport.updateTime = std::chrono::duration<f64>(std::chrono::steady_clock::now() - startTime).count();
 		return ret;
 	}
 
+	void ZVM::ApplyCommands() {
+		f64 totalLatency = 0;
+		frameReport.commands = commands.Drain([&](HostCommand const& cmd) {
+			Apply(cmd);
+			f64 latency = (HostCommand::Now() - cmd.queuedAt) * 1e-9;
+			totalLatency += latency;
+			frameReport.maxCommandLatency = max(frameReport.maxCommandLatency, latency);
+		});
+		if (!frameReport.commands) return;
+		frameReport.commandLatency = totalLatency / frameReport.commands;
+		// so the routines run in their new order this frame already.
+		if (toBeResorted.size()) ResortActive();
+	}
+
+	void ZVM::Apply(HostCommand const& cmd) {
+		switch (cmd.type) {
+		case HostCommand::Type::SET_VAR:
+			if (cmd.target == 0) {
+				// the VM's vars are all read-only to scripts, they're the host's to set.
+				if (auto ref = GetVarRef(cmd.var)) ref->get() = cmd.value;
+				else Logger::Log(Logger::LL::Warn) << "Host tried to set var " << cmd.var << ", which the VM doesn't have.";
+			} else if (auto rt = GetRoutineByInstance(cmd.target)) {
+				// through SetVar, so whatever waits on it wakes up.
+				if (i32 err = rt->get().SetVar(cmd.var, cmd.value)) Logger::Log(Logger::LL::Warn) << "Host couldn't set var " << cmd.var << " of instance " << cmd.target << " (" << err << ").";
+			} else {
+				Logger::Log(Logger::LL::Warn) << "Host tried to set a var of instance " << cmd.target << ", which doesn't exist.";
+			}
+			break;
+		case HostCommand::Type::SPAWN:
+			if (auto clone = CloneAndActivateTemplate(cmd.target, nullptr, std::span(cmd.args.data(), cmd.argc)); clone && cmd.group) SetGroup(*clone, cmd.group);
+			break;
+		case HostCommand::Type::KILL_GROUP:
+			KillGroup(cmd.group);
+			break;
+		case HostCommand::Type::SUSPEND_GROUP:
+			SuspendGroup(cmd.group);
+			break;
+		case HostCommand::Type::RESUME_GROUP:
+			ResumeGroup(cmd.group);
+			break;
+		case HostCommand::Type::SET_GROUP_PRIORITY:
+			SetGroupPriority(cmd.group, cmd.priority);
+			break;
+		case HostCommand::Type::SET_PRIORITY:
+			UpdatePriority(cmd.target, cmd.priority);
+			break;
+		default:
+			Logger::Log(Logger::LL::Warn) << "Unknown host command " << static_cast<u32>(cmd.type) << ".";
+		}
+	}
+
+	void ZVM::TakeSnapshot() {
+		SnapshotLayout const& layout = options.snapshotLayout;
+		FrameSnapshot& snap = snapshots.Back();
+		snap.frame = KnownVar(VTID::TIME).u;
+		// clearing keeps the capacity, so nothing's allocated unless there are more routines than there have ever been.
+		snap.instance.clear();
+		snap.x.clear();
+		snap.y.clear();
+		snap.angle.clear();
+		snap.type.clear();
+		snap.flags.clear();
+
+		// straight from the slots, so RAND and friends don't get rolled.
+		auto read = [](Routine& rt, u32 id) {
+			Value* slot = id == VTID::NIL ? nullptr : rt.FindVar(id);
+			return slot ? *slot : Value();
+		};
+		for (std::unique_ptr<Routine> const& rt : active) {
+			// it's gone as far as scripts can tell, it just hasn't been freed yet.
+			if (rt->deleteMe) continue;
+			snap.instance.push_back(rt->GetInstanceID());
+			snap.x.push_back(read(*rt, layout.x).f);
+			snap.y.push_back(read(*rt, layout.y).f);
+			snap.angle.push_back(read(*rt, layout.angle).f);
+			snap.type.push_back(layout.type == VTID::NIL ? static_cast<i32>(rt->subId) : read(*rt, layout.type).s);
+			snap.flags.push_back(read(*rt, layout.flags).s);
+		}
+		snapshots.Publish();
+	}
+
+	bool ZVM::CanDefer(Routine const& rt) const {
+		return options.frameTimeBudget > 0 && rt.deferrable && rt.priority <= options.deferPriority;
+	}
+
+	void ZVM::CatchUp(Routine& rt, u32 frame) {
+		if (!rt.blockedAt) return;
+		u32 skipped = frame - rt.blockedAt.value() - 1;
+		rt.KnownVar(VTID::CLOCK).s += skipped;
+		rt.KnownVar(VTID::TIME).u += skipped;
+		rt.blockedAt.reset();
+	}
+
+	std::set<std::unique_ptr<Routine>, Routine::Compare>::iterator ZVM::UpdateLockstep(std::set<std::unique_ptr<Routine>, Routine::Compare>::iterator first, u32 frame, bool& success) {
+		if (!options.lockstep) return first;
+		Routine& lead = **first;
+		CompiledSub const* compiled = GetCompiledSub(lead.subId);
+		if (!compiled || !compiled->CanLockstep()) return first;
+
+		// with the same priority, nothing they spawn can end up in between them.
+		auto last = first;
+		lockstepGroup.clear();
+		for (auto iter = first; iter != active.end(); last = iter++) {
+			Routine& rt = **iter;
+			if (rt.deleteMe || rt.blocked || rt.suspended || rt.subId != lead.subId || rt.priority != lead.priority) break;
+			// the ones Update could put off are left to it, or they'd never be.
+			if (CanDefer(rt)) break;
+			CatchUp(rt, frame);
+			if (rt.ptr != lead.ptr || rt.KnownVar(VTID::CLOCK).s != lead.KnownVar(VTID::CLOCK).s) break;
+			// the compiled tier is only built for RoutineBase templates, and their clones are RoutineBases too.
+			lockstepGroup.push_back(static_cast<RoutineBase*>(&rt));
+		}
+		if (lockstepGroup.size() < max(options.lockstepMinGroup, 1u)) return first;
+
+		frameReport.updated += static_cast<u32>(lockstepGroup.size());
+		if (!compiled->UpdateLockstep(lockstepGroup)) {
+			Logger::Log(Logger::LL::Error) << "Error updating a lockstep group of " << lockstepGroup.size() << " instances of sub " << lead.subId;
+			success = false;
+		}
+		// anything spawned goes after the group, where it would have been had they been updated one by one.
+		return std::next(last);
+	}
+
 	std::optional<std::reference_wrapper<Routine>> ZVM::GetRoutineByInstance(u32 instanceId) {
 		if (instanceId == 0) return std::nullopt;
 		for (std::unique_ptr<Routine> const& rt : active) {
@@ -107,6 +410,48 @@ namespace ZDrive::VM {
 		return rt_optref.value().get().SetVar(id.v, value);
 	}
 
+	bool ZVM::Block(Routine& rt, std::span<const u32> ids) {
+		// templates only update once, there's nothing to wake.
+		if (rt.GetInstanceID() == 0) return false;
+		std::vector<std::pair<Routine*, u32>> vars;
+		vars.reserve(ids.size());
+		for (ValPtr vptr : ids) {
+			// CLOCK and TIME change without being set.
+			if (vptr.v >= FLAT_VARS || vptr.v == VTID::CLOCK || vptr.v == VTID::TIME) return false;
+			auto owner = GetRoutineByInstance(vptr.b, rt);
+			if (!owner || !owner->get().HasVar(vptr.v) || !owner->get().IsCacheable(vptr.v)) return false;
+			vars.emplace_back(&owner->get(), static_cast<u32>(vptr.v));
+		}
+		if (vars.empty()) return false;
+
+		for (auto [owner, id] : vars) {
+			owner->waiters.emplace_back(id, &rt);
+			owner->watched |= 1ull << id;
+			if (std::ranges::find(rt.blockedOn, owner) == rt.blockedOn.end()) rt.blockedOn.push_back(owner);
+		}
+		rt.blocked = true;
+		rt.blockedAt = KnownVar(VTID::TIME).u;
+		return true;
+	}
+
+	void ZVM::Wake(Routine& owner, u32 id) {
+		std::vector<Routine*> woken;
+		for (auto [var, rt] : owner.waiters) {
+			if (var == id) woken.push_back(rt);
+		}
+		for (Routine* rt : woken) Unblock(*rt);
+	}
+
+	void ZVM::Unblock(Routine& rt) {
+		for (Routine* owner : rt.blockedOn) {
+			std::erase_if(owner->waiters, [&rt](auto const& waiter) { return waiter.second == &rt; });
+			owner->watched = 0;
+			for (auto [var, waiter] : owner->waiters) owner->watched |= 1ull << var;
+		}
+		rt.blockedOn.clear();
+		rt.blocked = false;
+	}
+
 	std::optional<Value> ZVM::GetVarByPtr(ValPtr id, Routine& asker) {
 		std::optional<std::reference_wrapper<Routine>> rt_optref = GetRoutineByInstance(id.b, asker);
 
@@ -138,16 +483,61 @@ namespace ZDrive::VM {
 		InitializeVars(defvars);
 	}
 
-	std::optional<std::reference_wrapper<Routine>> ZVM::CloneAndActivateTemplate(u32 subId) {
-		try {
-			std::unique_ptr<Routine> clone = templates.at(subId)->Clone(instanceTracker++);
-			Routine& ret = *clone;
-			active.insert(std::move(clone));
-			return ret;
-		} catch (std::out_of_range e) {
+	std::optional<std::reference_wrapper<Routine>> ZVM::CloneAndActivateTemplate(u32 subId, Routine const* parent, std::span<const Value> args) {
+		Routine* tmpl = GetTemplate(subId);
+		if (!tmpl) {
 			Logger::Log(Logger::LL::Error) << "Could not clone " << subId << ": not found.";
 			return std::nullopt;
 		}
+		std::unique_ptr<Routine> clone = tmpl->Clone(instanceTracker++);
+		if (parent) {
+			clone->InheritVarsFrom(*parent);
+			clone->PassVarsFrom(*parent);
+		}
+		for (u32 i = 0; i < args.size() && i < 8; i++) {
+			if (Value* in = clone->FindVar(VTID::IN0 + i)) *in = args[i];
+		}
+		JoinSpawnGroup(*clone, parent);
+		Routine& ret = *clone;
+		active.insert(std::move(clone));
+		return ret;
+	}
+
+	u32 ZVM::CloneAndActivateTemplates(u32 subId, Routine const* parent, u32 count, std::span<const Value> args) {
+		Routine* tmpl = GetTemplate(subId);
+		if (!tmpl) {
+			Logger::Log(Logger::LL::Error) << "Could not clone " << subId << ": not found.";
+			return 0;
+		}
+		if (count == 0) return 0;
+
+		// everything but the args is the same for every clone, so the parent's vars only go in once.
+		Routine const* source = tmpl;
+		std::unique_ptr<Routine> proto;
+		if (parent) {
+			proto = tmpl->Clone(0);
+			proto->InheritVarsFrom(*parent);
+			proto->PassVarsFrom(*parent);
+			source = proto.get();
+		}
+
+		const usize perClone = min(args.size() / count, static_cast<usize>(8));
+		const usize stride = args.size() / count;
+		std::vector<std::unique_ptr<Routine>> clones;
+		clones.reserve(count);
+		for (u32 i = 0; i < count; i++) {
+			std::unique_ptr<Routine> clone = source->Clone(instanceTracker++);
+			for (u32 j = 0; j < perClone; j++) {
+				if (Value* in = clone->FindVar(VTID::IN0 + j)) *in = args[i * stride + j];
+			}
+			JoinSpawnGroup(*clone, parent);
+			clones.push_back(std::move(clone));
+		}
+
+		// they all end up next to each other, in front of whatever comes after the first one. So that's only looked up once.
+		auto next = active.upper_bound(clones.front());
+		for (std::unique_ptr<Routine>& clone : clones) active.insert(next, std::move(clone));
+		return count;
 	}
 
 	void ZVM::UpdatePriority(u32 instanceId, i32 newPriority) {
@@ -162,6 +552,134 @@ namespace ZDrive::VM {
 		Logger::Log(Logger::LL::Error) << "Tried to update priority for non-existant instance: " << instanceId;
 	}
 
+	void ZVM::SetGroup(Routine& rt, u32 group) {
+		// templates aren't active, they only keep the tag for their clones.
+		if (rt.instanceId == 0) {
+			rt.group = group;
+			return;
+		}
+		if (rt.group == group) return;
+		UnlinkGroup(rt);
+		rt.group = group;
+		if (group == 0) return;
+		Group& g = groups[group];
+		rt.groupNext = g.head;
+		if (g.head) g.head->groupPrev = &rt;
+		g.head = &rt;
+		g.size++;
+	}
+
+	void ZVM::UnlinkGroup(Routine& rt) {
+		if (rt.group == 0 || rt.instanceId == 0) return;
+		auto res = groups.find(rt.group);
+		if (res == groups.end()) return;
+		if (rt.groupPrev) rt.groupPrev->groupNext = rt.groupNext;
+		else res->second.head = rt.groupNext;
+		if (rt.groupNext) rt.groupNext->groupPrev = rt.groupPrev;
+		rt.groupPrev = rt.groupNext = nullptr;
+		if (--res->second.size == 0) groups.erase(res);
+	}
+
+	void ZVM::JoinSpawnGroup(Routine& clone, Routine const* parent) {
+		// the clone has its template's tag, but isn't in the list yet.
+		u32 group = clone.group ? clone.group : parent ? parent->group : 0;
+		clone.group = 0;
+		clone.groupPrev = clone.groupNext = nullptr;
+		SetGroup(clone, group);
+	}
+
+	template<typename F>
+	u32 ZVM::ForEachInGroup(u32 group, F&& func) {
+		if (group == 0) return 0;
+		auto res = groups.find(group);
+		if (res == groups.end()) return 0;
+		for (Routine* rt = res->second.head; rt; rt = rt->groupNext) func(*rt);
+		return res->second.size;
+	}
+
+	u32 ZVM::KillGroup(u32 group) {
+		if (group == 0) return 0;
+		auto res = groups.find(group);
+		if (res == groups.end()) return 0;
+		// they leave the group now instead of when Update frees them, so they aren't counted (or killed) again until then.
+		u32 size = res->second.size;
+		for (Routine* rt = res->second.head; rt; ) {
+			Routine* next = rt->groupNext;
+			rt->deleteMe = true;
+			rt->group = 0;
+			rt->groupPrev = rt->groupNext = nullptr;
+			rt = next;
+		}
+		groups.erase(res);
+		return size;
+	}
+
+	u32 ZVM::SuspendGroup(u32 group) {
+		return ForEachInGroup(group, [](Routine& rt) { rt.suspended = true; });
+	}
+
+	u32 ZVM::ResumeGroup(u32 group) {
+		return ForEachInGroup(group, [](Routine& rt) { rt.suspended = false; });
+	}
+
+	u32 ZVM::SetGroupPriority(u32 group, i32 newPriority) {
+		return ForEachInGroup(group, [&](Routine& rt) {
+			if (rt.priority == newPriority) return;
+			rt.SetPriority(newPriority);
+			toBeResorted.push_back(&rt);
+		});
+	}
+
+	u32 ZVM::GroupSize(u32 group) const {
+		if (group == 0) return 0;
+		auto res = groups.find(group);
+		return res == groups.end() ? 0 : res->second.size;
+	}
+
+	u32 ZVM::RoutineBudget() const {
+		return options.routineInstructionBudget ? options.routineInstructionBudget : UINT32_MAX;
+	}
+
+	u32 ZVM::FrameBudgetLeft() const {
+		if (!options.frameInstructionBudget) return UINT32_MAX;
+		return frameExecuted >= options.frameInstructionBudget ? 0 : static_cast<u32>(options.frameInstructionBudget - frameExecuted);
+	}
+
+	void ZVM::OverBudget(Routine& rt, u32 executed) {
+		bool kill = options.overBudget == BudgetAction::KILL;
+		Logger::Log(kill ? Logger::LL::Error : Logger::LL::Warn) << "Routine {instance: " << rt.instanceId << ", sub: " << rt.subId << "} executed " << executed
+			<< " instructions in one update without waiting, and is at offset " << rt.ptr << ": " << Ins(rt.code.begin() + rt.ptr).toString()
+			<< (kill ? ". It will be terminated." : ". It will carry on from there next frame.");
+		if (kill) rt.deleteMe = true;
+	}
+
+	void ZVM::CountExecution(u32 subId, u32 count) {
+		if (!options.enableTierUp || subId >= execCounts.size() || compiledSubs[subId]) return;
+		if ((execCounts[subId] += count) < options.tierUpThreshold) return;
+		if (!templates[subId] || templates[subId]->GetTypeID() != RT::BASE) return;
+
+		compiledSubs[subId] = std::make_unique<CompiledSub>(static_cast<RoutineBase const&>(*templates[subId]));
+		Logger::Log(Logger::LL::Debug) << "Sub " << subId << " tiered up after " << execCounts[subId] << " instructions (" 
+			<< compiledSubs[subId]->FastCount() << "/" << compiledSubs[subId]->InstructionCount() << " instructions compiled).";
+	}
+
+	NativeSub::Fn ZVM::FindNativeSub(u32 subId, std::span<const i32> sub) const {
+		for (NativeSub const& native : options.nativeSubs) {
+			if (native.subId != subId) continue;
+			if (native.checksum == hashCode(sub)) return native.fn;
+			Logger::Log(Logger::LL::Warn) << "Native code for sub " << subId << " doesn't match its bytecode and will not be used. Transpile the script again.";
+			return nullptr;
+		}
+		return nullptr;
+	}
+
+	void ZVM::SetTierUp(bool enable) {
+		options.enableTierUp = enable;
+		if (enable) return;
+		for (auto& compiled : compiledSubs) compiled.reset();
+		std::fill(execCounts.begin(), execCounts.end(), 0);
+	}
+
 #ifdef _DEBUG
 	void ZVM::DebugDisassemble() const {
 		u32 rt_count = code[0];
@@ -176,21 +694,22 @@ namespace ZDrive::VM {
 			u32 start = code[i * 3 + 4];
 			Logger::Log(Logger::LL::Debug) << "------ Routine " << i << " ------";
 			Logger::Log(Logger::LL::Debug) << "type: " << typeId << ", offset: " << start << ", size: " << size;
-			templates[i]->DebugDisassemble();
+			if (templates[i]) templates[i]->DebugDisassemble();
+			else Logger::Log(Logger::LL::Debug) << (templateBuilt[i] ? "(deleted on construction)" : "(not built yet)");
 		}
 	}
 #endif // _DEBUG
 
 	void ZVM::ResortActive() {
-		for (auto const& ptr : toBeResorted) {
-			for (auto&& rt_uptr_iter = active.begin(); rt_uptr_iter != active.end(); rt_uptr_iter++) {
-				if ((*rt_uptr_iter)->GetInstanceID() == ptr->GetInstanceID()) {
-					std::unique_ptr<Routine> rt_uptr = std::move(active.extract(rt_uptr_iter).value());
-					active.insert(std::move(rt_uptr));
-					break;
-				}
-			}
+		// one pass pulls out all of them, so a whole group changing priority doesn't search active once per routine.
+		// compared by address only, something in here may have been deleted since.
+		std::unordered_set<Routine const*> moved(toBeResorted.begin(), toBeResorted.end());
+		std::vector<std::unique_ptr<Routine>> extracted;
+		for (auto iter = active.begin(); iter != active.end() && extracted.size() < moved.size(); ) {
+			auto cur = iter++;
+			if (moved.contains(cur->get())) extracted.push_back(std::move(active.extract(cur).value()));
 		}
+		for (std::unique_ptr<Routine>& rt : extracted) active.insert(std::move(rt));
 		toBeResorted.clear();
 	}
 
@@ -1,67 +1,91 @@
 #include "ZDriveVM.hpp"
 
+#include <bit>
+
 namespace ZDrive::VM {
 
 	void IHasVarTable::InitializeVars(std::vector<VarInitializeInfo> const& vars) {
-		vt.reserve(vt.size() + vars.size());
-		std::for_each(vars.begin(), vars.end(), [this](VarInitializeInfo const& info) { vt[info.id] = info.var; });
+		for (VarInitializeInfo const& info : vars) {
+			if (info.id >= FLAT_VARS) {
+				overflow[info.id] = info.var;
+				continue;
+			}
+			bool passes = info.var.pass_dest != VTID::NIL;
+			if (passes && info.var.pass_dest >= FLAT_VARS) {
+				Logger::Log(Logger::LL::Warn) << "Var " << info.id << " can't be passed from var " << info.var.pass_dest << ", only from ones below " << FLAT_VARS << ".";
+				passes = false;
+			}
+			const u64 bit = 1ull << info.id;
+			values[info.id] = info.var.val;
+			exists |= bit;
+			readOnly = info.var.read_only ? readOnly | bit : readOnly & ~bit;
+			inherit = info.var.inherit ? inherit | bit : inherit & ~bit;
+			pass = passes ? pass | bit : pass & ~bit;
+			passFrom[info.id] = static_cast<u8>(info.var.pass_dest);
+		}
 	}
 
 	void IHasVarTable::ClearVars() {
-		vt.clear();
+		exists = readOnly = inherit = pass = 0;
+		overflow.clear();
 	}
 
 	i32 IHasVarTable::SetVar(u32 id, Value val) {
-		auto res = vt.find(id);
-		if (res == vt.end()) return 1;
-		if (res->second.read_only) return 2;
-		res->second.val = val;
+		Value* slot = FindVar(id);
+		if (!slot) return 1;
+		if (IsReadOnly(id)) return 2;
+		*slot = val;
 		return 0;
 	}
 
 	std::optional<Value> IHasVarTable::GetVar(u32 id) {
-		//return GetVarRef(id).transform([](std::reference_wrapper<Value> const& ref) {return ref.get(); });
-		auto res = vt.find(id);
-		if (res == vt.end()) return std::nullopt;
-		return res->second.val;
+		Value* slot = FindVar(id);
+		if (!slot) return std::nullopt;
+		return *slot;
 	}
 
 	std::optional<std::reference_wrapper<Value>> IHasVarTable::GetVarRef(u32 id) {
-		auto res = vt.find(id);
-		if (res == vt.end()) return std::nullopt;
-		return res->second.val;
+		Value* slot = FindVar(id);
+		if (!slot) return std::nullopt;
+		return *slot;
 	}
 
 	// if (this->var.inhert) this->var.value = other.var.value
-	void IHasVarTable::InheritVarsFrom(IHasVarTable& other) {
-		for (auto& [id, var] : vt) {
-			// i had to do this weird if sequence because i didn't know if it would call GetVarRef before short-circuiting if i combined them. I don't want it to do that.
-			if (var.inherit) if (auto varoptref = GetVarRef(id); varoptref) if (const auto other_varopt = other.GetVar(id); other_varopt) {
-				varoptref.value().get() = Value(other_varopt.value());
-			}
+	void IHasVarTable::InheritVarsFrom(IHasVarTable const& other) {
+		// I0-7 and F0-7 are two runs, so this is usually two copies.
+		for (u64 mask = inherit & other.exists; mask; ) {
+			u32 first = std::countr_zero(mask);
+			u32 length = std::countr_one(mask >> first);
+			std::copy_n(other.values.begin() + first, length, values.begin() + first);
+			mask &= length == 64 ? 0 : ~(((1ull << length) - 1) << first);
 		}
-	}
-	// if (this->var.inhert) other.var.value = this->var.value
-	void IHasVarTable::InheritVarsTo(IHasVarTable& other) { 
-		for (auto& [id, var] : vt) {
-			if (var.inherit) if (const auto varopt = GetVar(id); varopt) if (auto other_varoptref = other.GetVarRef(id); other_varoptref) {
-				other_varoptref.value().get() = Value(varopt.value());
-			}
+		for (auto& [id, var] : overflow) {
+			if (!var.inherit) continue;
+			if (auto res = other.overflow.find(id); res != other.overflow.end()) var.val = res->second.val;
 		}
 	}
-	// if (this->var.pass) this->var.value = other.var.value
-	void IHasVarTable::PassVarsFrom(IHasVarTable& other) { 
-		for (auto& [id, var] : vt) {
-			if (var.pass_dest) if (auto varoptref = GetVarRef(id); varoptref) if (const auto other_varopt = other.GetVar(id); other_varopt) {
-				varoptref.value().get() = Value(other_varopt.value());
+
+	// if (this->var.pass) this->var.value = other.(var.pass_dest).value
+	void IHasVarTable::PassVarsFrom(IHasVarTable const& other) {
+		// a run of vars passed from a run of vars in other, eg. IN0-7 from OUT0-7, is one copy.
+		for (u64 mask = pass; mask; ) {
+			u32 first = std::countr_zero(mask);
+			u32 length = 1;
+			while (first + length < FLAT_VARS && ((mask >> (first + length)) & 1) && passFrom[first + length] == passFrom[first] + length) length++;
+			const u64 sources = (length == 64 ? ~0ull : (1ull << length) - 1) << passFrom[first];
+			if ((other.exists & sources) == sources && passFrom[first] + length <= FLAT_VARS) {
+				std::copy_n(other.values.begin() + passFrom[first], length, values.begin() + first);
+			} else {
+				for (u32 i = first; i < first + length; i++) if ((other.exists >> passFrom[i]) & 1) values[i] = other.values[passFrom[i]];
 			}
+			mask &= length == 64 ? 0 : ~(((1ull << length) - 1) << first);
 		}
-	}
-	// if (this->var.pass) other.var.value = this->var.value
-	void IHasVarTable::PassVarsTo(IHasVarTable& other) {
-		for (auto& [id, var] : vt) {
-			if (var.pass_dest) if (const auto varopt = GetVar(id); varopt) if (auto other_varoptref = other.GetVarRef(id); other_varoptref) {
-				other_varoptref.value().get() = Value(varopt.value());
+		for (auto& [id, var] : overflow) {
+			if (var.pass_dest == VTID::NIL) continue;
+			if (var.pass_dest < FLAT_VARS) {
+				if ((other.exists >> var.pass_dest) & 1) var.val = other.values[var.pass_dest];
+			} else if (auto res = other.overflow.find(var.pass_dest); res != other.overflow.end()) {
+				var.val = res->second.val;
 			}
 		}
 	}